@@ -0,0 +1,42 @@
+
+#ifndef SPARK_CANCELLATION_TOKEN_H
+#define SPARK_CANCELLATION_TOKEN_H
+
+#include "spark/utility.h"
+
+#include <memory>
+
+namespace Spark {
+    namespace Job {
+
+        // Cooperative cancellation for scheduled jobs. Copies share the same state, cancelling any copy cancels all of
+        // them. Jobs scheduled with a token that is cancelled before they start are skipped when a worker dequeues them:
+        // the job is not executed, but it still completes and releases its dependents. Long running jobs can poll
+        // IsCancelled on a copy of the token to stop early.
+        class CancellationToken {
+            public:
+                CancellationToken();
+                ~CancellationToken();
+
+                // Cannot be undone.
+                void Cancel();
+
+                NODISCARD bool IsCancelled() const;
+
+                // Number of jobs scheduled with this token that were skipped because of the cancellation.
+                NODISCARD std::uint64_t GetNumSkippedJobs() const;
+
+            private:
+                friend class JobHandle;
+                struct State {
+                    std::atomic<bool> isCancelled { false };
+                    std::atomic<std::uint64_t> numSkippedJobs { 0 };
+                };
+
+                std::shared_ptr<State> state_;
+        };
+
+    }
+}
+
+#endif //SPARK_CANCELLATION_TOKEN_H
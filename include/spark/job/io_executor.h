@@ -0,0 +1,124 @@
+
+#ifndef SPARK_IO_EXECUTOR_H
+#define SPARK_IO_EXECUTOR_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+#include "spark/job/job_definitions.h"
+
+#include <deque>
+#include <memory>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define SPARK_JOB_IO_URING
+    #include <sys/uio.h>
+#endif
+
+namespace Spark {
+    namespace Job {
+
+        namespace Internal {
+
+            class IoRing;
+
+        }
+
+        enum class IoOperationType {
+            READ,
+            WRITE
+        };
+
+        // Outcome of a read / write, valid once its handle has completed. Short reads and writes are reported as is.
+        struct IoResult {
+            std::size_t numBytes = 0;
+            int error = 0; // errno value, 0 on success.
+        };
+
+        // Job of an I/O handle (see JobSystem::Read). Holds the operation while it is in flight, the job itself only
+        // runs once the operation has completed and does nothing.
+        class IoJob : public IJob {
+            public:
+                IoJob(JobHandle* jobHandle, IoOperationType type, int fileDescriptor, void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result);
+                ~IoJob() override;
+
+                void Execute() override;
+
+            private:
+                friend class IoExecutor;
+                JobHandle* jobHandle_;
+                IoOperationType type_;
+                int fileDescriptor_;
+                void* buffer_;
+                std::size_t numBytes_;
+                std::uint64_t offset_;
+                IoResult* result_;
+
+                #ifdef SPARK_JOB_IO_URING
+                    // Buffer of the vectored operation used on kernels without plain io_uring reads / writes (before
+                    // 5.6), must stay valid while the operation is in flight.
+                    iovec vector_;
+                #endif
+        };
+
+        // Runs blocking reads and writes off the compute workers. Uses io_uring when the kernel allows it, keeping up to
+        // JOB_IO_QUEUE_DEPTH operations in flight with a single completion thread. Falls back to a pool of threads
+        // issuing pread / pwrite otherwise. Completed operations release their job handle, which is then submitted to
+        // the worker pool like any job whose dependencies have completed.
+        class IoExecutor {
+            public:
+                IoExecutor(unsigned numThreads, bool useIoUring);
+                ~IoExecutor();
+
+                // Waits for every operation in flight to complete.
+                void Shutdown();
+
+                // The job handle of the operation must be held (see JobHandle::Hold) until the operation completes.
+                void Submit(IoJob* job);
+
+                NODISCARD bool IsUsingIoUring() const;
+
+                // Bytes a single operation transfers at most (the Linux limit for one read / write, and within the 32
+                // bits of an io_uring length). Larger requests complete as short reads / writes.
+                static constexpr std::size_t MAX_TRANSFER = 0x7ffff000;
+
+                // Operations submitted and not yet completed.
+                NODISCARD std::size_t GetNumInFlight() const;
+
+                // I/O executors should not be copied.
+                IoExecutor& operator=(const IoExecutor& other) = delete;
+                IoExecutor(const IoExecutor& other) = delete;
+
+            private:
+                // Stores the result of the operation (bytes transferred, or -errno) and releases its job handle.
+                void Complete(IoJob* job, std::int64_t result);
+
+                // Blocking fallback.
+                void RunThread();
+
+                // Operations waiting for a fallback thread, or for room in the ring.
+                std::mutex mutex_;
+                std::condition_variable condition_;
+                std::deque<IoJob*> pending_;
+                bool isShuttingDown_;
+
+                std::atomic<std::size_t> numInFlight_;
+                std::vector<std::thread> threads_;
+
+                #ifdef SPARK_JOB_IO_URING
+                    // Reaps completions, and moves pending operations into the ring as room frees up.
+                    void RunCompletionThread();
+
+                    // Queues the operation in the ring (which must have room for it). Returns 0, or the errno value if
+                    // the kernel did not accept the operation.
+                    int Push(IoJob* job);
+
+                    // nullptr when the kernel does not support (or does not allow) io_uring.
+                    std::unique_ptr<Internal::IoRing> ring_;
+                    unsigned numRingOperations_;
+                #endif
+        };
+
+    }
+}
+
+#endif //SPARK_IO_EXECUTOR_H
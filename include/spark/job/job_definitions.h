@@ -3,20 +3,189 @@
 #define SPARK_JOB_DEFINITIONS_H
 
 #include "spark/utility.h"
-#include "spark/job/job_types.h"
 
 namespace Spark {
     namespace Job {
 
         class JobHandle;
+        class ManagedJobHandle;
 
-        typedef std::variant<std::monostate, JOB_TYPES> JobVariant; // Allow default constructable std::variant via std::monostate.
-        typedef std::pair<JobHandle*, JobVariant> JobEntry;
-        typedef std::unique_ptr<JobHandle, std::function<void(JobHandle*)>> ManagedJobHandle;
+        // Size of the storage each job handle reserves for its job. Jobs (including lambda captures) larger than this
+        // are allocated from the frame arena of the scheduling thread, or from a pool once the arena is full.
+        #ifndef JOB_INLINE_STORAGE_SIZE
+            #define JOB_INLINE_STORAGE_SIZE 64
+        #endif
 
-        // Number of total jobs this queue can hold.
+        // Bytes of the frame arena each scheduling thread allocates on first use, 0 disables frame arenas. The arena is
+        // split into JOB_FRAME_ARENA_SEGMENTS equal segments, each reset once every job allocated from it has
+        // completed. Every frame (JobSystem::BeginFrame) starts in a segment of its own, so jobs still running from an
+        // earlier frame, or long-lived blocks such as coroutine frames, only hold on to their own segment.
+        #ifndef JOB_FRAME_ARENA_SIZE
+            #define JOB_FRAME_ARENA_SIZE (256 * 1024)
+        #endif
+
+        #ifndef JOB_FRAME_ARENA_SEGMENTS
+            #define JOB_FRAME_ARENA_SEGMENTS 8
+        #endif
+
+        // Jobs of a higher priority are picked up first, both from a worker's own queues and when stealing.
+        enum class JobPriority {
+            CRITICAL,   // Frame-critical work.
+            NORMAL,
+            BACKGROUND  // Asset decompression, log compaction, etc.
+        };
+
+        #define NUM_JOB_PRIORITIES 3
+
+        // Number of times a worker picks a higher priority job while a lower priority queue is not empty before the
+        // lower priority job goes first (prevents starvation of background jobs).
+        #ifndef JOB_PRIORITY_AGING_LIMIT
+            #define JOB_PRIORITY_AGING_LIMIT 64
+        #endif
+
+        // Percentage of the frame budget after which a frame counts as at risk, worker threads then leave background jobs
+        // for the next frame (see JobSystem::BeginFrame).
+        #ifndef JOB_FRAME_RISK_THRESHOLD
+            #define JOB_FRAME_RISK_THRESHOLD 75
+        #endif
+
+        // How worker threads are placed on the processors of the machine.
+        enum class ThreadPinning {
+            NONE,           // Workers are scheduled by the OS.
+            LOGICAL_CORES,  // Each worker is pinned to one hardware thread.
+            PHYSICAL_CORES  // Each worker is pinned to its own physical core, SMT siblings are left unused.
+        };
+
+        // How many jobs a thief takes from a victim per steal.
+        enum class StealPolicy {
+            SINGLE,  // One job.
+            HALF     // Half of the victim's queue (up to WORKER_STEAL_BATCH_SIZE), spreads large fan-outs faster.
+        };
+
+        // What a thread outside the worker pool does when the injection queue it submits to is full.
+        enum class OverflowPolicy {
+            GROW,   // Queue the job in an unbounded (locked) overflow list.
+            BLOCK,  // Wait for the workers to make room.
+            INLINE  // Run the job on the submitting thread.
+        };
+
+        // Capacity of each injection queue (one per JobPriority) for jobs submitted from threads outside the worker
+        // pool. Must be a power of 2.
+        #ifndef JOB_INJECTION_QUEUE_CAPACITY
+            #define JOB_INJECTION_QUEUE_CAPACITY 4096
+        #endif
+
+        #ifndef WORKER_STEAL_BATCH_SIZE
+            #define WORKER_STEAL_BATCH_SIZE 32
+        #endif
+
+        // Elastic worker pools sample the number of queued jobs at most every WORKER_POOL_SAMPLE_INTERVAL milliseconds
+        // into an average that decays with a half-life of WORKER_POOL_DEPTH_HALF_LIFE milliseconds, so the gaps between
+        // bursts (frames) only lower it gradually. A worker thread is started while the average is above
+        // WORKER_POOL_GROW_DEPTH queued jobs per active worker (at most one per half-life), and retired once the average
+        // has stayed below one queued job for WORKER_POOL_RETIRE_DELAY milliseconds.
+        #ifndef WORKER_POOL_SAMPLE_INTERVAL
+            #define WORKER_POOL_SAMPLE_INTERVAL 10
+        #endif
+
+        #ifndef WORKER_POOL_DEPTH_HALF_LIFE
+            #define WORKER_POOL_DEPTH_HALF_LIFE 100
+        #endif
+
+        #ifndef WORKER_POOL_RETIRE_DELAY
+            #define WORKER_POOL_RETIRE_DELAY 1000
+        #endif
+
+        #ifndef WORKER_POOL_GROW_DEPTH
+            #define WORKER_POOL_GROW_DEPTH 8
+        #endif
+
+        // Fiber mode (see WorkerPoolConfiguration): default stack size and number of fibers per worker. Workers move
+        // WORKER_FIBER_CACHE_SIZE fibers at a time between the shared fiber pool and their own cache.
+        #ifndef JOB_FIBER_STACK_SIZE
+            #define JOB_FIBER_STACK_SIZE (64 * 1024)
+        #endif
+
+        #ifndef JOB_FIBERS_PER_WORKER
+            #define JOB_FIBERS_PER_WORKER 32
+        #endif
+
+        #ifndef WORKER_FIBER_CACHE_SIZE
+            #define WORKER_FIBER_CACHE_SIZE 8
+        #endif
+
+        // Number of trace events each worker keeps when built with SPARK_JOB_TRACING (16 bytes each), older events are
+        // overwritten. Must be a power of 2.
+        #ifndef JOB_TRACE_BUFFER_SIZE
+            #define JOB_TRACE_BUFFER_SIZE (64 * 1024)
+        #endif
+
+        // Reads / writes the I/O executor keeps in flight with io_uring, and the number of threads issuing blocking
+        // reads / writes when io_uring is not available.
+        #ifndef JOB_IO_QUEUE_DEPTH
+            #define JOB_IO_QUEUE_DEPTH 256
+        #endif
+
+        #ifndef JOB_IO_THREADS
+            #define JOB_IO_THREADS 4
+        #endif
+
+        // Number of jobs a worker queue can hold before it needs to grow. Must be a power of 2.
         #define WORKER_JOB_CAPACITY 4096
 
+        // Number of consecutive iterations a worker spends looking for work before parking.
+        #ifndef WORKER_IDLE_SPIN_COUNT
+            #define WORKER_IDLE_SPIN_COUNT 128
+        #endif
+
+        namespace Internal {
+
+            // Xorshift32, state must not be zero.
+            inline std::uint32_t NextRandom(std::uint32_t& state) {
+                state ^= state << 13u;
+                state ^= state >> 17u;
+                state ^= state << 5u;
+                return state;
+            }
+
+            // Maps a random number to [0, range) without division.
+            inline std::uint32_t ReduceRandom(std::uint32_t random, std::uint32_t range) {
+                return static_cast<std::uint32_t>((static_cast<std::uint64_t>(random) * range) >> 32u);
+            }
+
+        }
+
+        // Park / wake transitions of the worker pool, used to tune WORKER_IDLE_SPIN_COUNT.
+        struct IdleStatistics {
+            std::uint64_t numParks = 0;         // Number of times workers went to sleep.
+            std::uint64_t numWakeups = 0;       // Number of times workers were woken up by a notification.
+            std::uint64_t numNotifications = 0; // Number of notifications sent to parked workers by Schedule.
+        };
+
+        // Summary of a frame, see JobSystem::EndFrame.
+        struct FrameReport {
+            std::uint64_t frameIndex = 0;
+            std::chrono::nanoseconds duration { 0 };
+            std::chrono::nanoseconds budget { 0 };
+            std::uint64_t numDeadlineJobs = 0;    // Jobs with a deadline that finished during the frame.
+            std::uint64_t numMissedDeadlines = 0; // Jobs of those that finished after their deadline.
+            std::uint64_t numDeferredJobs = 0;    // Background jobs left queued for the next frame (approximate).
+            bool wasAtRisk = false;               // Background jobs were deferred at some point during the frame.
+        };
+
+        // Counters of a single worker, or of the whole worker pool (summed, peakQueueDepth is the highest of any
+        // worker). Counters only ever increase, rates come from the difference between two calls.
+        struct WorkerStatistics {
+            std::uint64_t numExecutedJobs = 0; // Jobs run to completion, once each however often they suspended.
+            std::uint64_t numSkippedJobs = 0;  // Jobs skipped because their CancellationToken was cancelled.
+            std::uint64_t numSteals = 0;       // Jobs taken from other workers.
+            std::uint64_t numFailedSteals = 0; // Rounds over every other worker that found nothing to steal.
+            std::uint64_t numRequeuedJobs = 0; // Jobs that suspended in WaitFor, queued again once the awaited job completes.
+            std::uint64_t idleTime = 0;        // Nanoseconds spent parked, added when the worker wakes up.
+            std::uint64_t peakQueueDepth = 0;  // Most jobs seen in a single deque of the worker at once.
+            std::uint64_t numQueuedJobs = 0;   // Jobs queued at the time of the call (approximate).
+        };
+
     }
 }
 
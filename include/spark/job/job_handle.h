@@ -3,51 +3,159 @@
 #define SPARK_JOB_HANDLE_H
 
 #include "spark/utility.h"
-#include "spark/job/types/job.h"
+#include "spark/job/job_storage.h"
+#include "spark/job/cancellation_token.h"
 #include "spark/job/job_definitions.h"
 
 namespace Spark {
     namespace Job {
 
+        class Fiber;
+
+        // Pooled job record owned by the JobHandleManager. A handle is returned to the pool as soon as its job
+        // completes, and every reuse increments its generation. Outside references hold the generation they were given
+        // (see ManagedJobHandle) so operations on a handle that has since been recycled are detected.
         class JobHandle {
             public:
                 JobHandle();
                 ~JobHandle();
 
-                void AddDependency(const ManagedJobHandle& managedJobHandle);
-
-                // Blocks thread until job is complete.
-                void Complete();
-
-                NODISCARD bool IsReady() const;
-
                 // Job handles should not be copied.
                 JobHandle& operator=(const JobHandle& other) = delete;
                 JobHandle(const JobHandle& other) = delete;
                 JobHandle(JobHandle&& other) = delete;
 
             private:
-                friend class JobHandleManager;
-                // Sets this and all dependencies to be ready for execution.
-                void Stage(const std::function<void(JobHandle*)>& callback);
-                void Stage();
+                friend class ManagedJobHandle;
+                void AddDependency(JobHandle* dependency, std::uint32_t dependencyGeneration);
+
+                // Takes over the cancellation token of the dependency, if it has one and has not completed yet.
+                void InheritCancellation(JobHandle* dependency, std::uint32_t dependencyGeneration);
+
+                // Blocks thread until job is complete. Ready jobs are executed while waiting (from the worker's own
+                // queue when called from a worker thread, stolen otherwise); the thread parks when none are available.
+                void Complete(std::uint32_t generation);
+
+                NODISCARD bool IsStaged(std::uint32_t generation) const;
+
+                // A handle that has been recycled (generation no longer matches) belonged to a completed job.
+                NODISCARD bool IsComplete(std::uint32_t generation) const;
 
-                // Reset handle to default values for reuse.
+                // Sets this and all dependencies to be ready for execution. Does nothing if the job was already staged
+                // or the handle has been recycled.
+                void Stage(std::uint32_t generation);
+                friend class JobHandleManager;
+                // Reset handle to default values for reuse. Completes the job for anyone holding the old generation.
                 void Reset();
 
                 friend class Worker;
+                // Marks the job as finished and releases all dependent jobs.
                 void Signal();
-                NODISCARD const std::vector<JobHandle*>& GetDependencies() const;
 
-                std::vector<JobHandle*> dependencies_;
-                bool waitedOnComplete_;
-                std::function<void(JobHandle*)> callback_;
+                // Registers a job this job waits on before it counts as complete. May only be called while this job
+                // (or one of its existing children) is executing.
+                void AddChild(JobHandle* child);
+
+                // Called once the job, and once each of its children, has finished executing. Returns true when
+                // nothing is left running and the job can be signaled.
+                NODISCARD bool Finish();
+                NODISCARD JobHandle* GetParent() const;
+
+                // Returns true if any thread is parked in Complete, called after the handle has been recycled.
+                NODISCARD bool HasWaiters() const;
+
+                // Fiber the job is running on in fiber mode.
+                void SetFiber(Fiber* fiber);
+                NODISCARD Fiber* GetFiber() const;
+
+                // Called from the running job before its fiber suspends. The job is submitted again (and its fiber
+                // resumed) once the dependency completes and ReleaseDependency has been called for the suspension.
+                void WaitOn(JobHandle* dependency, std::uint32_t dependencyGeneration);
+
+                // Registers a job to be released when this job completes. Returns false if this job has already
+                // completed (or the handle was recycled), in which case the dependent job does not need to wait on it.
+                NODISCARD bool AddDependent(JobHandle* dependent, std::uint32_t generation);
+
+                friend class IoExecutor;
+                // Decrements the number of pending dependencies and submits the job for execution once it reaches zero.
+                void ReleaseDependency();
+
+                friend class JobSystem;
+                friend class JobAwaiter;
+                friend class WorkerPool;
+                NODISCARD std::uint32_t GetGeneration() const;
 
-                std::atomic<bool> isComplete_;
-                std::atomic<bool> isReady_;
+                // Keeps the job from being submitted until ReleaseDependency is called once more, for jobs waiting on
+                // something other than a job (see IoExecutor).
+                void Hold();
+
+                // Stages a job without dependencies, leaving it to the caller to submit it (see
+                // WorkerPool::SubmitBatch).
+                void StageWithoutSubmit();
+
+                void SetPriority(JobPriority priority);
+                NODISCARD JobPriority GetPriority() const;
+
+                // Must be set before the job is staged.
+                void SetCancellationToken(const CancellationToken& token);
+
+                // Jobs with a deadline are run earliest deadline first, ahead of jobs without one. Must be set before
+                // the job is staged.
+                void SetDeadline(std::chrono::steady_clock::time_point deadline);
+                NODISCARD bool HasDeadline() const;
+                NODISCARD std::chrono::steady_clock::time_point GetDeadline() const;
+
+                // Returns true (and counts the job as skipped) if the job has not started and its token is cancelled.
+                NODISCARD bool Skip();
+
+                template <typename T, typename ...Args>
+                T& SetJob(Args&& ...args);
+                NODISCARD JobStorage& GetJob();
+
+                // Status word: generation in the upper 31 bits, staged flag in the lowest bit.
+                static constexpr std::uint32_t STAGED_BIT = 1u;
+                std::atomic<std::uint32_t> status_;
+
+                // Pool bookkeeping.
+                std::uint32_t index_;
+                std::atomic<std::uint32_t> nextFree_;
+
+                // Jobs this job depends on (with their generation at the time of AddDependency), used to stage
+                // dependencies when this job is staged.
+                std::vector<std::pair<JobHandle*, std::uint32_t>> dependencies_;
+                JobStorage job_;
+                JobPriority priority_;
+
+                // Shared with the CancellationToken the job was scheduled with, nullptr for jobs that cannot be
+                // cancelled. Cleared under dependentsMutex_, see InheritCancellation.
+                std::shared_ptr<CancellationToken::State> cancellation_;
+
+                // time_point::max() for jobs without a deadline.
+                std::chrono::steady_clock::time_point deadline_;
+
+                // Number of incomplete dependencies + 1 for the job not being staged yet. The job is submitted to a
+                // worker when this reaches zero.
+                std::atomic<int> numPendingDependencies_;
+
+                // Jobs waiting on this job. Closed (no more dependents accepted) once this job completes.
+                std::mutex dependentsMutex_;
+                std::vector<JobHandle*> dependents_;
+                bool dependentsClosed_;
+
+                // Number of children still running + 1 for the job itself. Jobs spawned from within a running job
+                // (see ParallelFor) complete their parent once the last of them finishes.
+                std::atomic<int> numUnfinishedJobs_;
+                JobHandle* parent_;
+
+                // Threads parked in Complete. Not reset on reuse, a waiter may still be parked on an earlier generation.
+                std::atomic<unsigned> numWaiters_;
+
+                Fiber* fiber_;
         };
 
     }
 }
 
+#include "spark/job/job_handle.tpp"
+
 #endif //SPARK_JOB_HANDLE_H
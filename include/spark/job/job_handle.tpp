@@ -0,0 +1,14 @@
+
+#ifndef SPARK_JOB_HANDLE_TPP
+#define SPARK_JOB_HANDLE_TPP
+
+namespace Spark::Job {
+
+    template <typename T, typename... Args>
+    T& JobHandle::SetJob(Args&& ...args) {
+        return job_.Emplace<T>(std::forward<Args>(args)...);
+    }
+
+}
+
+#endif //SPARK_JOB_HANDLE_TPP
@@ -8,17 +8,53 @@
 namespace Spark {
     namespace Job {
 
+        // Preallocated pool of JobHandles with a lock-free intrusive free list. Handles are allocated in chunks of
+        // 'capacity' handles; a new chunk is only allocated when all existing handles are in use.
         class JobHandleManager {
             public:
-                JobHandleManager();
+                explicit JobHandleManager(std::size_t capacity);
                 ~JobHandleManager();
 
-                NODISCARD ManagedJobHandle GetAvailableJobHandle();
+                // Never returns nullptr.
+                NODISCARD JobHandle* GetAvailableJobHandle();
 
-            private:
+                // Fills 'jobHandles' with 'count' handles, taken off the free list with a single CAS while enough handles
+                // are available.
+                void GetAvailableJobHandles(JobHandle** jobHandles, std::size_t count);
+
+                // Handle must not be referenced by any worker queue after it is returned.
                 void ReturnJobHandle(JobHandle* jobHandle);
 
-                std::unordered_set<JobHandle*> validHandles_;
+                NODISCARD std::size_t GetCapacity() const;
+
+                // Job handle managers should not be copied.
+                JobHandleManager& operator=(const JobHandleManager& other) = delete;
+                JobHandleManager(const JobHandleManager& other) = delete;
+
+            private:
+                static constexpr std::uint32_t NULL_INDEX = 0xFFFFFFFFu;
+                static constexpr std::size_t MAX_CHUNKS = 64;
+
+                NODISCARD JobHandle* GetJobHandle(std::uint32_t index) const;
+
+                NODISCARD JobHandle* PopFreeList();
+
+                // Pops up to 'count' handles at once. Returns the number of handles popped.
+                NODISCARD std::size_t PopFreeList(JobHandle** jobHandles, std::size_t count);
+
+                // Pushes the list of handles first -> ... -> last (linked through nextFree_).
+                void PushFreeList(JobHandle* first, JobHandle* last);
+
+                void AllocateChunk();
+
+                std::uint32_t chunkSize_;
+
+                // Free list head: ABA tag in the upper 32 bits, index of the first free handle in the lower 32 bits.
+                alignas(64) std::atomic<std::uint64_t> freeList_;
+
+                std::mutex chunkMutex_;
+                std::atomic<std::size_t> numChunks_;
+                std::atomic<JobHandle*> chunks_[MAX_CHUNKS];
         };
 
     }
@@ -0,0 +1,79 @@
+
+#ifndef SPARK_JOB_STORAGE_H
+#define SPARK_JOB_STORAGE_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+#include "spark/job/job_definitions.h"
+
+namespace Spark {
+    namespace Job {
+
+        namespace Internal {
+
+            // Blocks for jobs that do not fit in JobStorage inline storage, taken from the frame arena of the calling
+            // thread while it has room, and from a thread-safe pool of fixed size blocks otherwise. Blocks can be
+            // deallocated from any thread.
+            NODISCARD void* AllocateJobBlock(std::size_t numBytes);
+            void DeallocateJobBlock(void* address, std::size_t numBytes);
+
+            // Starts a new frame, the frame arena of every thread moves on to a free segment on its next allocation.
+            // Called by JobSystem::BeginFrame.
+            void BeginJobBlockFrame();
+
+            // Blocks taken from the block pool because the frame arena had no room, since the start of the process.
+            NODISCARD std::uint64_t GetNumPooledJobBlocks();
+
+        }
+
+        // Type-erased storage for a single job. Jobs are either classes deriving from IJob or arbitrary callables taking
+        // no arguments (lambdas, function objects, function pointers). Jobs up to JOB_INLINE_STORAGE_SIZE bytes are
+        // constructed in place; larger jobs are constructed in a block from Internal::AllocateJobBlock.
+        class JobStorage {
+            public:
+                JobStorage();
+                ~JobStorage();
+
+                // Constructs a job of type T from the given arguments. Storage must be empty.
+                template <typename T, typename ...Args>
+                T& Emplace(Args&& ...args);
+
+                // Storage must not be empty.
+                void Execute();
+
+                // Destroys the stored job, if any.
+                void Reset();
+
+                NODISCARD bool IsEmpty() const;
+
+                // Job storage should not be copied or moved, jobs are executed from where they are constructed.
+                JobStorage& operator=(const JobStorage& other) = delete;
+                JobStorage(const JobStorage& other) = delete;
+                JobStorage(JobStorage&& other) = delete;
+
+            private:
+                enum class Operation {
+                    EXECUTE,
+                    DESTROY
+                };
+
+                // One trampoline is instantiated per job type.
+                typedef void (*Trampoline)(Operation operation, void* job);
+
+                template <typename T>
+                static void Invoke(Operation operation, void* job);
+
+                template <typename T>
+                static constexpr bool IsStoredInline();
+
+                alignas(std::max_align_t) unsigned char storage_[JOB_INLINE_STORAGE_SIZE];
+                void* job_;
+                Trampoline trampoline_;
+        };
+
+    }
+}
+
+#include "spark/job/job_storage.tpp"
+
+#endif //SPARK_JOB_STORAGE_H
@@ -0,0 +1,59 @@
+
+#ifndef SPARK_JOB_STORAGE_TPP
+#define SPARK_JOB_STORAGE_TPP
+
+namespace Spark::Job {
+
+    template <typename T, typename... Args>
+    T& JobStorage::Emplace(Args&& ...args) {
+        static_assert(std::is_base_of_v<IJob, T> || std::is_invocable_v<T&>, "Job type must derive from IJob or be callable with no arguments.");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned job types are not supported.");
+        SP_ASSERT(IsEmpty(), "JobStorage already contains a job.");
+
+        T* job;
+        if constexpr (IsStoredInline<T>()) {
+            job = new (storage_) T(std::forward<Args>(args)...);
+        }
+        else {
+            void* block = Internal::AllocateJobBlock(sizeof(T));
+            job = new (block) T(std::forward<Args>(args)...);
+        }
+
+        job_ = job;
+        trampoline_ = &JobStorage::Invoke<T>;
+        return *job;
+    }
+
+    template <typename T>
+    void JobStorage::Invoke(Operation operation, void* job) {
+        T* object = static_cast<T*>(job);
+
+        switch (operation) {
+            case Operation::EXECUTE:
+                if constexpr (std::is_base_of_v<IJob, T>) {
+                    // Type is known, skip virtual dispatch.
+                    object->T::Execute();
+                }
+                else {
+                    (*object)();
+                }
+                break;
+
+            case Operation::DESTROY:
+                object->~T();
+
+                if constexpr (!IsStoredInline<T>()) {
+                    Internal::DeallocateJobBlock(object, sizeof(T));
+                }
+                break;
+        }
+    }
+
+    template <typename T>
+    constexpr bool JobStorage::IsStoredInline() {
+        return sizeof(T) <= JOB_INLINE_STORAGE_SIZE;
+    }
+
+}
+
+#endif //SPARK_JOB_STORAGE_TPP
@@ -6,7 +6,19 @@
 #include "spark/tools/singleton.h"
 #include "spark/job/worker/worker.h"
 #include "spark/job/types/job.h"
+#include "spark/job/types/parallel_for_job.h"
+#include "spark/job/types/batch_job.h"
+#include "spark/job/task_graph.h"
+#include "spark/job/pipeline.h"
+#include "spark/job/io_executor.h"
+
+#ifdef SPARK_JOB_COROUTINES
+    #include "spark/job/types/task.h"
+#endif
+
 #include "spark/job/job_handle.h"
+#include "spark/job/managed_job_handle.h"
+#include "spark/job/cancellation_token.h"
 #include "spark/job/worker_pool.h"
 #include "spark/job/job_handle_manager.h"
 #include "spark/job/job_definitions.h"
@@ -21,27 +33,162 @@ namespace Spark {
                 JobSystem();
                 ~JobSystem() override;
 
-                // Job automatically gets scheduled for execution when JobHandle goes out of scope.
+                // Must be called before the job system is first accessed. The thread that first accesses the job system
+                // becomes worker 0 (main thread).
+                static void Configure(const WorkerPoolConfiguration& configuration);
+
+                // Job automatically gets scheduled for execution when ManagedJobHandle goes out of scope.
                 // This allows for dependency setup between jobs without having to synchronize.
+                // T must derive from IJob or be callable with no arguments, and gets constructed from the given
+                // arguments.
                 template <typename T, typename ...Args>
                 ManagedJobHandle Schedule(Args&& ...args);
 
-            private:
-                template <typename Target, typename ...Types>
-                void ValidateJobType() const;
+                // Schedules a lambda / function object, for example: Schedule([&data]() { ... });
+                template <typename Callable, typename = std::enable_if_t<std::is_invocable_v<std::decay_t<Callable>&>>>
+                ManagedJobHandle Schedule(Callable&& callable);
+
+                // Same as above, with a priority other than JobPriority::NORMAL.
+                template <typename T, typename ...Args>
+                ManagedJobHandle Schedule(JobPriority priority, Args&& ...args);
+                template <typename Callable, typename = std::enable_if_t<std::is_invocable_v<std::decay_t<Callable>&>>>
+                ManagedJobHandle Schedule(JobPriority priority, Callable&& callable);
+
+                // Same as above, skipped if the token is cancelled before a worker starts the job (see
+                // CancellationToken). Continuations added through ManagedJobHandle::Then inherit the token.
+                template <typename T, typename ...Args>
+                ManagedJobHandle Schedule(CancellationToken token, JobPriority priority, Args&& ...args);
+                template <typename Callable, typename = std::enable_if_t<std::is_invocable_v<std::decay_t<Callable>&>>>
+                ManagedJobHandle Schedule(CancellationToken token, JobPriority priority, Callable&& callable);
+
+                // Schedules one job of type T per argument, constructed from that argument, for example:
+                //     ScheduleBatch<DecompressJob>(chunks.data(), chunks.size());
+                // All handles are taken from the pool at once, and once the returned handle is staged (and its
+                // dependencies complete) the jobs are split evenly over the active worker threads, one contiguous run
+                // per worker. The returned handle completes once every job of the batch has completed.
+                template <typename T, typename Argument>
+                ManagedJobHandle ScheduleBatch(const Argument* arguments, std::size_t count);
+                template <typename T, typename Argument>
+                ManagedJobHandle ScheduleBatch(const std::vector<Argument>& arguments);
+                template <typename T, typename Argument>
+                ManagedJobHandle ScheduleBatch(JobPriority priority, const Argument* arguments, std::size_t count);
+
+                #ifdef SPARK_JOB_COROUTINES
+                    // Runs the task as a job. The returned handle completes once the task, and every task it awaited,
+                    // has completed.
+                    ManagedJobHandle Schedule(Task<void> task);
+                    ManagedJobHandle Schedule(JobPriority priority, Task<void> task);
+                #endif
+
+                // Calls function(index) for every index in [begin, end), or function(rangeBegin, rangeEnd) for
+                // consecutive sub-ranges of at most 'grain' indices. The returned handle completes once the whole range
+                // has been processed and takes part in dependencies like any other job.
+                template <typename Function>
+                ManagedJobHandle ParallelFor(std::size_t begin, std::size_t end, std::size_t grain, Function&& function);
+
+                // Folds reduce(value, map(index)) over [begin, end), starting from identity, and stores the result once
+                // the returned handle completes. Partial results of sub-ranges are combined in range order, reduce must
+                // be associative (not necessarily commutative).
+                template <typename T, typename Map, typename Reduce>
+                ManagedJobHandle ParallelReduce(std::size_t begin, std::size_t end, std::size_t grain, T identity, Map&& map, Reduce&& reduce, T& result);
+
+                // Waits for the job to complete from within a running job. In fiber mode the calling job is suspended and
+                // its worker moves on to other jobs, the job resumes (on any worker) once the awaited job completes.
+                // Thread local state must not be kept across the call. Behaves like ManagedJobHandle::Complete
+                // otherwise.
+                void WaitFor(const ManagedJobHandle& handle);
+
+                // Replays a task graph, compiling it first if it changed. The returned handle completes once every task
+                // has run and takes part in dependencies like any other job. A graph can only be run again once the
+                // previous run completed, invalid handles are returned otherwise (or if the graph has a cycle).
+                ManagedJobHandle Run(TaskGraph& graph);
+                ManagedJobHandle Run(JobPriority priority, TaskGraph& graph);
 
+                // Runs the pipeline with at most numTokens items in flight. The returned handle completes once the input
+                // has ended and every item has passed the last stage, and takes part in dependencies like any other job.
+                // A pipeline can only be run again once the previous run completed, invalid handles are returned
+                // otherwise (or if it has no input).
+                ManagedJobHandle Run(Pipeline& pipeline, unsigned numTokens);
+                ManagedJobHandle Run(JobPriority priority, Pipeline& pipeline, unsigned numTokens);
+
+                // Reads / writes numBytes at offset of the file on the I/O executor, so no worker blocks on the system
+                // call. The operation starts right away, the returned handle completes once it has completed (result
+                // holds the outcome by then) and takes part in dependencies like any other job:
+                //     ManagedJobHandle read = jobSystem->Read(file, buffer, size, 0, &result);
+                //     ManagedJobHandle parse = jobSystem->Schedule<Parse>(buffer, &result);
+                //     parse.AddDependency(read);
+                // Buffer and result must stay valid until the handle completes. At most IoExecutor::MAX_TRANSFER bytes are
+                // transferred per operation, larger requests are reported as short reads / writes.
+                ManagedJobHandle Read(int fileDescriptor, void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result);
+                ManagedJobHandle Write(int fileDescriptor, const void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result);
+
+                // Starts a frame with the given budget (called once per frame, from the main thread). Once
+                // JOB_FRAME_RISK_THRESHOLD percent of the budget has passed, or a job misses its deadline, the frame is
+                // at risk and worker threads leave background jobs for the next frame. Threads waiting in Complete still
+                // run background jobs. EndFrame returns the report of the frame, deadlines missed included. Oversized jobs
+                // of the frame are allocated from their own frame arena segments (see JOB_FRAME_ARENA_SEGMENTS).
+                void BeginFrame(std::chrono::steady_clock::duration budget = std::chrono::microseconds(16667));
+                FrameReport EndFrame();
+
+                // Park / wake transitions of idle workers.
+                NODISCARD IdleStatistics GetIdleStatistics() const;
+
+                // Always-on counters, cheap enough to poll while running. Per worker (worker 0 is the main thread) or
+                // summed over the worker pool.
+                NODISCARD std::vector<WorkerStatistics> GetWorkerStatistics() const;
+                NODISCARD WorkerStatistics GetStatistics() const;
+
+                // Including the main thread.
+                NODISCARD unsigned GetNumActiveWorkers() const;
+
+                // Writes the trace events recorded by every worker as Chrome trace JSON (chrome://tracing, Perfetto).
+                // Workers keep their last JOB_TRACE_BUFFER_SIZE events. Requires building with SPARK_JOB_TRACING,
+                // returns false otherwise or if the file could not be written.
+                bool WriteTrace(const std::string& filename) const;
+
+            private:
                 void ReturnJobHandle(JobHandle* jobHandle);
 
+                ManagedJobHandle SubmitIo(IoOperationType type, int fileDescriptor, void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result);
+
+                template <typename Body>
+                friend class ParallelRangeJob;
+                friend class TaskGraph;
+                friend class Pipeline;
+                friend class BatchJob;
+
+                #ifdef SPARK_JOB_COROUTINES
+                    friend class JobAwaiter;
+                    // Resumes the coroutine once the dependency completes, through a child of the task's root job.
+                    void ScheduleContinuation(JobHandle* root, JobHandle* dependency, std::uint32_t dependencyGeneration, std::coroutine_handle<> coroutine);
+                #endif
+                // Schedules a job the parent waits on before completing, called from the parent (or one of its
+                // children) while it is executing. Children run at the priority of their parent.
+                template <typename T, typename ...Args>
+                void ScheduleChild(JobHandle* parent, Args&& ...args);
+
                 friend class Worker;
-                NODISCARD const WorkerPool& GetWorkerPool() const;
+                friend class JobHandle;
+                friend class ManagedJobHandle;
+                NODISCARD WorkerPool& GetWorkerPool();
+
+                static WorkerPoolConfiguration configuration_;
+                static std::atomic<bool> isConstructed_;
 
                 WorkerPool workerPool_;
                 JobHandleManager jobHandleManager_;
+                IoExecutor ioExecutor_;
         };
 
     }
 }
 
 #include "spark/job/job_system.tpp"
+#include "spark/job/types/parallel_for_job.tpp"
+#include "spark/job/managed_job_handle.tpp"
+
+#ifdef SPARK_JOB_COROUTINES
+    #include "spark/job/types/task.tpp"
+#endif
 
 #endif //SPARK_JOB_SYSTEM_H
@@ -6,17 +6,102 @@ namespace Spark::Job {
 
     template <typename T, typename... Args>
     ManagedJobHandle JobSystem::Schedule(Args&& ...args) {
-        ValidateJobType<T, JOB_TYPES>();
-        Worker* worker = workerPool_.GetRandomWorker();
+        return Schedule<T>(JobPriority::NORMAL, std::forward<Args>(args)...);
+    }
+
+    template <typename Callable, typename>
+    ManagedJobHandle JobSystem::Schedule(Callable&& callable) {
+        return Schedule(JobPriority::NORMAL, std::forward<Callable>(callable));
+    }
+
+    template <typename T, typename... Args>
+    ManagedJobHandle JobSystem::Schedule(JobPriority priority, Args&& ...args) {
+        // Job gets submitted to a worker once it is staged and all of its dependencies are complete.
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<T>(std::forward<Args>(args)...);
+        jobHandle->SetPriority(priority);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    template <typename Callable, typename>
+    ManagedJobHandle JobSystem::Schedule(JobPriority priority, Callable&& callable) {
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<std::decay_t<Callable>>(std::forward<Callable>(callable));
+        jobHandle->SetPriority(priority);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    template <typename T, typename... Args>
+    ManagedJobHandle JobSystem::Schedule(CancellationToken token, JobPriority priority, Args&& ...args) {
+        ManagedJobHandle handle = Schedule<T>(priority, std::forward<Args>(args)...);
+        handle.jobHandle_->SetCancellationToken(token);
+        return handle;
+    }
+
+    template <typename Callable, typename>
+    ManagedJobHandle JobSystem::Schedule(CancellationToken token, JobPriority priority, Callable&& callable) {
+        ManagedJobHandle handle = Schedule(priority, std::forward<Callable>(callable));
+        handle.jobHandle_->SetCancellationToken(token);
+        return handle;
+    }
 
-        ManagedJobHandle managedJobHandle = jobHandleManager_.GetAvailableJobHandle();
-        worker->Schedule<T>(managedJobHandle.get(), std::forward<Args>(args)... );
-        return managedJobHandle;
+    template <typename T, typename Argument>
+    ManagedJobHandle JobSystem::ScheduleBatch(const Argument* arguments, std::size_t count) {
+        return ScheduleBatch<T>(JobPriority::NORMAL, arguments, count);
     }
 
-    template <typename Target, typename... Types>
-    void Job::JobSystem::ValidateJobType() const {
-        static_assert((std::is_same_v<Target, Types> || ...), "Job type passed into JobSystem::Schedule must be registered in the JOB_TYPES macro.");
+    template <typename T, typename Argument>
+    ManagedJobHandle JobSystem::ScheduleBatch(const std::vector<Argument>& arguments) {
+        return ScheduleBatch<T>(JobPriority::NORMAL, arguments.data(), arguments.size());
+    }
+
+    template <typename T, typename Argument>
+    ManagedJobHandle JobSystem::ScheduleBatch(JobPriority priority, const Argument* arguments, std::size_t count) {
+        // One handle per job, followed by the root.
+        std::vector<JobHandle*> jobs(count + 1);
+        jobHandleManager_.GetAvailableJobHandles(jobs.data(), jobs.size());
+
+        JobHandle* root = jobs.back();
+        jobs.pop_back();
+
+        // Jobs are staged right away as children of the root, which is not staged yet and so cannot complete before
+        // they are submitted.
+        for (std::size_t i = 0; i < count; ++i) {
+            jobs[i]->SetJob<T>(arguments[i]);
+            jobs[i]->SetPriority(priority);
+            jobs[i]->StageWithoutSubmit();
+            root->AddChild(jobs[i]);
+        }
+
+        root->SetJob<BatchJob>(std::move(jobs));
+        root->SetPriority(priority);
+        return ManagedJobHandle(root, root->GetGeneration());
+    }
+
+    template <typename Function>
+    ManagedJobHandle JobSystem::ParallelFor(std::size_t begin, std::size_t end, std::size_t grain, Function&& function) {
+        // Root job processes the range itself, splitting it up further as other workers run out of jobs.
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<ParallelForJob<std::decay_t<Function>>>(jobHandle, begin, end, grain, std::forward<Function>(function));
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    ManagedJobHandle JobSystem::ParallelReduce(std::size_t begin, std::size_t end, std::size_t grain, T identity, Map&& map, Reduce&& reduce, T& result) {
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<ParallelReduceJob<T, std::decay_t<Map>, std::decay_t<Reduce>>>(jobHandle, begin, end, grain, std::move(identity), std::forward<Map>(map), std::forward<Reduce>(reduce), &result);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    template <typename T, typename... Args>
+    void JobSystem::ScheduleChild(JobHandle* parent, Args&& ...args) {
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<T>(std::forward<Args>(args)...);
+        jobHandle->SetPriority(parent->GetPriority());
+        parent->AddChild(jobHandle);
+
+        // Children have no dependencies, staging submits them to the calling worker right away.
+        jobHandle->Stage(jobHandle->GetGeneration());
     }
 
 }
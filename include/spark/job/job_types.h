@@ -1,10 +0,0 @@
-
-#ifndef SPARK_JOB_TYPES_H
-#define SPARK_JOB_TYPES_H
-
-// Job includes go here:
-#include "spark/job/types/job.h"
-
-#define JOB_TYPES ::Spark::Job::Test
-
-#endif //SPARK_JOB_TYPES_H
@@ -0,0 +1,86 @@
+
+#ifndef SPARK_MANAGED_JOB_HANDLE_H
+#define SPARK_MANAGED_JOB_HANDLE_H
+
+#include "spark/utility.h"
+#include "spark/job/job_definitions.h"
+
+namespace Spark {
+    namespace Job {
+
+        // Owning reference to a scheduled job. The job gets staged for execution when the ManagedJobHandle goes out of
+        // scope (or Complete is called), which allows for dependency setup between jobs without having to synchronize.
+        // Holds the generation of the pooled JobHandle it refers to: once the job completes the handle may be reused
+        // for another job, and any further operations through this reference treat the job as complete.
+        class ManagedJobHandle {
+            public:
+                ManagedJobHandle();
+                ~ManagedJobHandle();
+
+                ManagedJobHandle(ManagedJobHandle&& other) noexcept;
+                ManagedJobHandle& operator=(ManagedJobHandle&& other) noexcept;
+
+                // Managed job handles should not be copied.
+                ManagedJobHandle(const ManagedJobHandle& other) = delete;
+                ManagedJobHandle& operator=(const ManagedJobHandle& other) = delete;
+
+                // Dependencies must be added before the job is staged.
+                void AddDependency(const ManagedJobHandle& dependency);
+
+                // Runnable jobs with a deadline are run earliest deadline first, ahead of the jobs of the same (and lower)
+                // priority without one, never ahead of higher priority jobs. Background jobs with a deadline are left for
+                // later while the frame is at risk, like any other background job. Jobs that finish after their deadline
+                // are reported as missed in the FrameReport of the current frame. Must be set before the job is staged.
+                void SetDeadline(std::chrono::steady_clock::time_point deadline);
+
+                // Sets the deadline to the end of the current frame's budget (see JobSystem::BeginFrame).
+                void SetFrameDeadline();
+
+                // Schedules a job (T constructed from the arguments, or a callable) that runs once this job completes,
+                // at the same priority. Released continuations are pushed onto the deque of the worker that completed
+                // this job, at the end it pops from next, so they pick up this job's data while it is still in cache.
+                // Continuations inherit the cancellation token of this job while it is pending. Returns the handle of the
+                // continuation, for example:
+                //     jobSystem->Schedule<Load>(path).Then<Parse>(&document).Then([]() { ... });
+                template <typename T, typename ...Args>
+                ManagedJobHandle Then(Args&& ...args) const;
+                template <typename Callable, typename = std::enable_if_t<std::is_invocable_v<std::decay_t<Callable>&>>>
+                ManagedJobHandle Then(Callable&& callable) const;
+
+                // Blocks thread until job is complete.
+                void Complete();
+
+                NODISCARD bool IsComplete() const;
+
+                // Returns false for default constructed or moved-from handles.
+                NODISCARD bool IsValid() const;
+
+            private:
+                // Logs a warning and returns false for invalid handles.
+                NODISCARD bool CanContinue() const;
+                NODISCARD JobPriority GetPriority() const;
+
+                // Completing this job releases the continuation onto the completing worker (see JobHandle::Signal). Also
+                // passes on the cancellation token.
+                void AddContinuation(const ManagedJobHandle& continuation) const;
+
+                friend class JobSystem;
+                friend class JobAwaiter;
+                // Called by the scheduling thread, once the priority of the job is set.
+                ManagedJobHandle(JobHandle* jobHandle, std::uint32_t generation);
+
+                // Stages the job and drops the reference.
+                void Release();
+
+                JobHandle* jobHandle_;
+                std::uint32_t generation_;
+
+                // Copied when the job is scheduled, the job handle may already have been recycled for another job by the
+                // time a continuation is added.
+                JobPriority priority_;
+        };
+
+    }
+}
+
+#endif //SPARK_MANAGED_JOB_HANDLE_H
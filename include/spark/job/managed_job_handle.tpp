@@ -0,0 +1,31 @@
+
+#ifndef SPARK_MANAGED_JOB_HANDLE_TPP
+#define SPARK_MANAGED_JOB_HANDLE_TPP
+
+namespace Spark::Job {
+
+    template <typename T, typename... Args>
+    ManagedJobHandle ManagedJobHandle::Then(Args&& ...args) const {
+        if (!CanContinue()) {
+            return ManagedJobHandle();
+        }
+
+        ManagedJobHandle continuation = Singleton<JobSystem>::GetInstance()->Schedule<T>(GetPriority(), std::forward<Args>(args)...);
+        AddContinuation(continuation);
+        return continuation;
+    }
+
+    template <typename Callable, typename>
+    ManagedJobHandle ManagedJobHandle::Then(Callable&& callable) const {
+        if (!CanContinue()) {
+            return ManagedJobHandle();
+        }
+
+        ManagedJobHandle continuation = Singleton<JobSystem>::GetInstance()->Schedule(GetPriority(), std::forward<Callable>(callable));
+        AddContinuation(continuation);
+        return continuation;
+    }
+
+}
+
+#endif //SPARK_MANAGED_JOB_HANDLE_TPP
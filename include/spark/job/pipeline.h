@@ -0,0 +1,128 @@
+
+#ifndef SPARK_PIPELINE_H
+#define SPARK_PIPELINE_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+
+        enum class PipelineStageMode {
+            PARALLEL,            // Any number of tokens at once.
+            SERIAL_IN_ORDER,     // One token at a time, in the order the input produced them.
+            SERIAL_OUT_OF_ORDER  // One token at a time, in any order.
+        };
+
+        // Stream of items processed by a sequence of stages, replayed through JobSystem::Run, for example:
+        //     std::vector<Chunk> chunks(numTokens);
+        //     pipeline.SetInput([&](unsigned token) { return Read(file, chunks[token]); });
+        //     pipeline.AddStage(PipelineStageMode::PARALLEL, [&](unsigned token) { Decode(chunks[token]); });
+        //     pipeline.AddStage(PipelineStageMode::SERIAL_IN_ORDER, [&](unsigned token) { Write(chunks[token]); });
+        //     jobSystem->Run(pipeline, numTokens).Complete();
+        // At most numTokens items are in flight at once, numbered [0, numTokens). The data of an item is owned by the
+        // caller and indexed by its token, which is reused once the item has passed the last stage. Every token in
+        // flight runs as its own job, a token waiting for a serial stage is parked (without a job) until the token
+        // leaving the stage hands it over.
+        class Pipeline {
+            public:
+                Pipeline();
+                ~Pipeline();
+
+                // Pipelines should not be copied or moved, running jobs refer to them.
+                Pipeline(const Pipeline& other) = delete;
+                Pipeline& operator=(const Pipeline& other) = delete;
+
+                // Runs serially and fills in the item of the given token, returns false (without producing an item) once
+                // the stream has ended.
+                void SetInput(std::function<bool(unsigned token)> input);
+
+                // Stages run in the order they were added, after the input.
+                void AddStage(PipelineStageMode mode, std::function<void(unsigned token)> stage);
+
+                NODISCARD bool HasInput() const;
+                NODISCARD bool IsRunning() const;
+                NODISCARD unsigned GetNumStages() const;
+
+            private:
+                friend class JobSystem;
+                friend class PipelineJob;
+
+                // Token parked in front of a serial stage.
+                struct WaitingToken {
+                    unsigned token;
+                    std::uint64_t sequence;
+                };
+
+                struct Stage {
+                    Stage(PipelineStageMode mode, std::function<void(unsigned)> function);
+
+                    PipelineStageMode mode;
+                    std::function<void(unsigned)> function;
+
+                    std::mutex mutex;
+                    bool isBusy;
+                    std::uint64_t nextSequence; // SERIAL_IN_ORDER only.
+
+                    // Indexed by sequence modulo the number of tokens for SERIAL_IN_ORDER, the tokens in flight always
+                    // have consecutive sequence numbers.
+                    std::vector<WaitingToken> waiting;
+                };
+
+                // Resets the stages and runs the input with the first token, as part of the root job.
+                void Start(JobHandle* root, unsigned numTokens);
+
+                // Runs the token through the given stage (held by the caller if serial) and the stages after it, and
+                // back through the input once it has passed the last stage. Returns once the token is parked or the
+                // stream has ended.
+                void Execute(unsigned token, std::uint64_t sequence, unsigned stage, JobHandle* root);
+
+                // Returns false if the token was parked.
+                bool AcquireInput(unsigned token);
+                bool AcquireStage(Stage& stage, unsigned token, std::uint64_t sequence);
+
+                // Hands the stage over to the next waiting token, scheduled as a child of the root job.
+                void ReleaseInput(JobHandle* root);
+                void ReleaseStage(Stage& stage, unsigned index, JobHandle* root);
+
+                // Called with the token that found the end of the stream.
+                void EndInput(unsigned token);
+
+                std::function<bool(unsigned)> input_;
+                std::vector<std::unique_ptr<Stage>> stages_;
+                unsigned numTokens_;
+
+                std::mutex inputMutex_;
+                std::vector<unsigned> freeTokens_;
+                bool isInputBusy_;
+                bool isInputEnded_;
+                std::uint64_t nextSequence_; // Only touched by the token holding the input.
+
+                std::atomic<bool> isRunning_;
+        };
+
+        // Runs one token of a pipeline from the given stage (the root job starts the pipeline).
+        class PipelineJob : public IJob {
+            public:
+                PipelineJob(Pipeline* pipeline, JobHandle* root, unsigned token, std::uint64_t sequence, unsigned stage);
+                void Execute() override;
+
+                // Marks the root job, which gets the number of tokens instead of a token.
+                static constexpr unsigned ROOT = std::numeric_limits<unsigned>::max();
+                // Marks a token holding the input.
+                static constexpr unsigned INPUT = ROOT - 1;
+
+            private:
+                Pipeline* pipeline_;
+                JobHandle* root_;
+                unsigned token_;
+                std::uint64_t sequence_;
+                unsigned stage_;
+        };
+
+    }
+}
+
+#endif //SPARK_PIPELINE_H
@@ -0,0 +1,86 @@
+
+#ifndef SPARK_TASK_GRAPH_H
+#define SPARK_TASK_GRAPH_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+
+        // Dependency structure that is built once and replayed many times through JobSystem::Run, for example:
+        //     unsigned update = graph.AddTask([]() { ... });
+        //     unsigned render = graph.AddTask([]() { ... });
+        //     graph.AddEdge(update, render);
+        //     jobSystem->Run(graph).Complete();
+        // Compiling flattens the edges into per-task indegrees and successor lists. Replaying only resets one counter
+        // per task, no per-run allocation happens besides pooled JobHandles for tasks that run in parallel.
+        class TaskGraph {
+            public:
+                TaskGraph();
+                ~TaskGraph();
+
+                // Task graphs should not be copied or moved, running jobs refer to them.
+                TaskGraph(const TaskGraph& other) = delete;
+                TaskGraph& operator=(const TaskGraph& other) = delete;
+
+                // Returns the index of the task, used to add edges.
+                unsigned AddTask(std::function<void()> task);
+
+                // Task 'after' starts once task 'before' has completed.
+                void AddEdge(unsigned before, unsigned after);
+
+                // Called by JobSystem::Run if the graph changed since it was last compiled. Returns false (and the graph
+                // cannot be run) if the edges contain a cycle.
+                bool Compile();
+
+                NODISCARD bool IsCompiled() const;
+                NODISCARD bool IsRunning() const;
+                NODISCARD unsigned GetNumTasks() const;
+
+            private:
+                friend class JobSystem;
+                friend class TaskGraphJob;
+                // Resets task counters and starts every task without predecessors, as children of the root job.
+                void Start(JobHandle* root);
+
+                // Runs the task, then continues with one of the successors it released on the calling worker. Other
+                // released successors are scheduled as children of the root job.
+                void Execute(unsigned task, JobHandle* root);
+
+                std::vector<std::function<void()>> tasks_;
+                std::vector<std::pair<unsigned, unsigned>> edges_;
+
+                // Compiled graph. Successors of task i are successors_[successorOffsets_[i], successorOffsets_[i + 1]).
+                std::vector<unsigned> indegrees_;
+                std::vector<unsigned> successorOffsets_;
+                std::vector<unsigned> successors_;
+                std::vector<unsigned> roots_;
+                std::unique_ptr<std::atomic<unsigned>[]> numPendingPredecessors_;
+                bool isCompiled_;
+
+                std::atomic<unsigned> numUnfinishedTasks_;
+                std::atomic<bool> isRunning_;
+        };
+
+        // Runs one task of a task graph (the root job starts the graph).
+        class TaskGraphJob : public IJob {
+            public:
+                TaskGraphJob(TaskGraph* graph, JobHandle* root, unsigned task);
+                void Execute() override;
+
+                // Marks the root job.
+                static constexpr unsigned ROOT = std::numeric_limits<unsigned>::max();
+
+            private:
+                TaskGraph* graph_;
+                JobHandle* root_;
+                unsigned task_;
+        };
+
+    }
+}
+
+#endif //SPARK_TASK_GRAPH_H
@@ -0,0 +1,27 @@
+
+#ifndef SPARK_BATCH_JOB_H
+#define SPARK_BATCH_JOB_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+
+        // Root job of JobSystem::ScheduleBatch. The jobs of the batch are its children, already staged, and get handed
+        // to the worker pool in one go once the root runs (after its dependencies complete).
+        class BatchJob : public IJob {
+            public:
+                explicit BatchJob(std::vector<JobHandle*> jobs);
+                void Execute() override;
+
+            private:
+                std::vector<JobHandle*> jobs_;
+        };
+
+    }
+}
+
+#endif //SPARK_BATCH_JOB_H
@@ -0,0 +1,95 @@
+
+#ifndef SPARK_PARALLEL_FOR_JOB_H
+#define SPARK_PARALLEL_FOR_JOB_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+
+        // Sub-range of a ParallelFor / ParallelReduce. Ranges are split lazily: a job only hands off half of its
+        // remaining range when the worker running it has nothing else queued, so the range is only divided as far
+        // as idle workers are there to steal it. Every job folds the chunks it processes into a single partial, which
+        // is handed to the body once (Body::EndRange) when the job is done.
+        template <typename Body>
+        class ParallelRangeJob : public IJob {
+            public:
+                ParallelRangeJob(Body* body, JobHandle* root, std::size_t begin, std::size_t end);
+                void Execute() override;
+
+                // Processes [begin, end) in chunks of at most the body's grain size. Split off halves are scheduled as
+                // children of the root job, which completes once the last of them finishes.
+                static void Split(Body* body, JobHandle* root, std::size_t begin, std::size_t end);
+
+            private:
+                Body* body_;
+                JobHandle* root_;
+                std::size_t begin_;
+                std::size_t end_;
+        };
+
+        // Root job of JobSystem::ParallelFor. Owns the function, which stays alive until all sub-ranges complete.
+        template <typename Function>
+        class ParallelForJob : public IJob {
+            public:
+                ParallelForJob(JobHandle* root, std::size_t begin, std::size_t end, std::size_t grain, Function function);
+                void Execute() override;
+
+                // Nothing to combine.
+                struct Partial { };
+
+                NODISCARD std::size_t GetGrain() const;
+                NODISCARD Partial BeginRange() const;
+                void SplitRange();
+                void Process(std::size_t begin, std::size_t end, Partial& partial);
+                void EndRange(std::size_t begin, Partial&& partial);
+
+            private:
+                JobHandle* root_;
+                std::size_t begin_;
+                std::size_t end_;
+                std::size_t grain_;
+                Function function_;
+        };
+
+        // Root job of JobSystem::ParallelReduce. Every sub-range job folds its chunks into a local value. The last
+        // sub-range to finish combines the values in range order into the result, so reduce only has to be
+        // associative.
+        template <typename T, typename Map, typename Reduce>
+        class ParallelReduceJob : public IJob {
+            public:
+                ParallelReduceJob(JobHandle* root, std::size_t begin, std::size_t end, std::size_t grain, T identity, Map map, Reduce reduce, T* result);
+                void Execute() override;
+
+                using Partial = T;
+
+                NODISCARD std::size_t GetGrain() const;
+                NODISCARD Partial BeginRange() const;
+                void SplitRange();
+                void Process(std::size_t begin, std::size_t end, Partial& partial);
+                void EndRange(std::size_t begin, Partial&& partial);
+
+            private:
+                JobHandle* root_;
+                std::size_t begin_;
+                std::size_t end_;
+                std::size_t grain_;
+
+                T identity_;
+                Map map_;
+                Reduce reduce_;
+
+                // Partial values by the first index of their sub-range, one per sub-range job.
+                std::mutex partialsMutex_;
+                std::vector<std::pair<std::size_t, T>> partials_;
+                std::atomic<std::size_t> numUnfinishedRanges_;
+                T* result_;
+        };
+
+    }
+}
+
+#endif //SPARK_PARALLEL_FOR_JOB_H
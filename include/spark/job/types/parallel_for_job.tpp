@@ -0,0 +1,157 @@
+
+#ifndef SPARK_PARALLEL_FOR_JOB_TPP
+#define SPARK_PARALLEL_FOR_JOB_TPP
+
+namespace Spark::Job {
+
+    template <typename Body>
+    ParallelRangeJob<Body>::ParallelRangeJob(Body* body, JobHandle* root, std::size_t begin, std::size_t end) : body_(body),
+                                                                                                                root_(root),
+                                                                                                                begin_(begin),
+                                                                                                                end_(end)
+                                                                                                                {
+    }
+
+    template <typename Body>
+    void ParallelRangeJob<Body>::Execute() {
+        Split(body_, root_, begin_, end_);
+    }
+
+    template <typename Body>
+    void ParallelRangeJob<Body>::Split(Body* body, JobHandle* root, std::size_t begin, std::size_t end) {
+        std::size_t grain = body->GetGrain();
+        std::size_t rangeBegin = begin;
+        typename Body::Partial partial = body->BeginRange();
+
+        while (begin < end) {
+            // An empty queue means a thief would find nothing to take, give it the upper half of the range.
+            Worker* worker = Worker::GetCurrentWorker();
+            if (end - begin > grain && (!worker || !worker->HasQueuedJobs())) {
+                std::size_t middle = begin + (end - begin) / 2;
+                body->SplitRange();
+                Singleton<JobSystem>::GetInstance()->template ScheduleChild<ParallelRangeJob<Body>>(root, body, root, middle, end);
+                end = middle;
+                continue;
+            }
+
+            std::size_t chunkEnd = begin + std::min(grain, end - begin);
+            body->Process(begin, chunkEnd, partial);
+            begin = chunkEnd;
+        }
+
+        body->EndRange(rangeBegin, std::move(partial));
+    }
+
+    template <typename Function>
+    ParallelForJob<Function>::ParallelForJob(JobHandle* root, std::size_t begin, std::size_t end, std::size_t grain, Function function) : root_(root),
+                                                                                                                                          begin_(begin),
+                                                                                                                                          end_(end),
+                                                                                                                                          grain_(std::max<std::size_t>(grain, 1)),
+                                                                                                                                          function_(std::move(function))
+                                                                                                                                          {
+    }
+
+    template <typename Function>
+    void ParallelForJob<Function>::Execute() {
+        ParallelRangeJob<ParallelForJob<Function>>::Split(this, root_, begin_, end_);
+    }
+
+    template <typename Function>
+    std::size_t ParallelForJob<Function>::GetGrain() const {
+        return grain_;
+    }
+
+    template <typename Function>
+    typename ParallelForJob<Function>::Partial ParallelForJob<Function>::BeginRange() const {
+        return { };
+    }
+
+    template <typename Function>
+    void ParallelForJob<Function>::SplitRange() {
+    }
+
+    template <typename Function>
+    void ParallelForJob<Function>::Process(std::size_t begin, std::size_t end, Partial&) {
+        if constexpr (std::is_invocable_v<Function&, std::size_t, std::size_t>) {
+            function_(begin, end);
+        }
+        else {
+            for (std::size_t index = begin; index < end; ++index) {
+                function_(index);
+            }
+        }
+    }
+
+    template <typename Function>
+    void ParallelForJob<Function>::EndRange(std::size_t, Partial&&) {
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    ParallelReduceJob<T, Map, Reduce>::ParallelReduceJob(JobHandle* root, std::size_t begin, std::size_t end, std::size_t grain, T identity, Map map, Reduce reduce, T* result) : root_(root),
+                                                                                                                                                                                  begin_(begin),
+                                                                                                                                                                                  end_(end),
+                                                                                                                                                                                  grain_(std::max<std::size_t>(grain, 1)),
+                                                                                                                                                                                  identity_(std::move(identity)),
+                                                                                                                                                                                  map_(std::move(map)),
+                                                                                                                                                                                  reduce_(std::move(reduce)),
+                                                                                                                                                                                  numUnfinishedRanges_(1),
+                                                                                                                                                                                  result_(result)
+                                                                                                                                                                                  {
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    void ParallelReduceJob<T, Map, Reduce>::Execute() {
+        ParallelRangeJob<ParallelReduceJob<T, Map, Reduce>>::Split(this, root_, begin_, end_);
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    std::size_t ParallelReduceJob<T, Map, Reduce>::GetGrain() const {
+        return grain_;
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    typename ParallelReduceJob<T, Map, Reduce>::Partial ParallelReduceJob<T, Map, Reduce>::BeginRange() const {
+        return identity_;
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    void ParallelReduceJob<T, Map, Reduce>::SplitRange() {
+        // Before the child is scheduled, the splitting range is still unfinished so the count cannot reach 0.
+        numUnfinishedRanges_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    void ParallelReduceJob<T, Map, Reduce>::Process(std::size_t begin, std::size_t end, Partial& partial) {
+        for (std::size_t index = begin; index < end; ++index) {
+            partial = reduce_(std::move(partial), map_(index));
+        }
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    void ParallelReduceJob<T, Map, Reduce>::EndRange(std::size_t begin, Partial&& partial) {
+        {
+            std::scoped_lock<std::mutex> lock(partialsMutex_);
+            partials_.emplace_back(begin, std::move(partial));
+        }
+
+        if (numUnfinishedRanges_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+
+        // Last sub-range, sub-ranges are contiguous and do not overlap so ordering by their first index restores the
+        // order of the range.
+        std::sort(partials_.begin(), partials_.end(), [](const std::pair<std::size_t, T>& first, const std::pair<std::size_t, T>& second) {
+            return first.first < second.first;
+        });
+
+        T value = identity_;
+        for (std::pair<std::size_t, T>& entry : partials_) {
+            value = reduce_(std::move(value), std::move(entry.second));
+        }
+
+        *result_ = std::move(value);
+    }
+
+}
+
+#endif //SPARK_PARALLEL_FOR_JOB_TPP
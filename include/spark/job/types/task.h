@@ -0,0 +1,171 @@
+
+#ifndef SPARK_TASK_H
+#define SPARK_TASK_H
+
+#include "spark/utility.h"
+#include "spark/job/types/job.h"
+#include <coroutine>
+#include <optional>
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+        class ManagedJobHandle;
+
+        template <typename T>
+        class Task;
+
+        // Continues with the awaiting task once a task completes.
+        class TaskFinalAwaiter {
+            public:
+                explicit TaskFinalAwaiter(std::coroutine_handle<> continuation);
+
+                NODISCARD bool await_ready() const noexcept;
+                NODISCARD std::coroutine_handle<> await_suspend(std::coroutine_handle<> coroutine) const noexcept;
+                void await_resume() const noexcept;
+
+            private:
+                std::coroutine_handle<> continuation_;
+        };
+
+        // Part of the promise shared by every Task: frame allocation, and the job the task runs under.
+        class TaskPromiseBase {
+            public:
+                // Frames are allocated from the job block pool.
+                NODISCARD static void* operator new(std::size_t numBytes);
+                static void operator delete(void* address, std::size_t numBytes);
+
+                // Tasks start once they are scheduled or awaited.
+                std::suspend_always initial_suspend() const noexcept;
+
+                NODISCARD TaskFinalAwaiter final_suspend() const noexcept;
+
+                // Jobs do not throw.
+                void unhandled_exception() const;
+
+                void SetRoot(JobHandle* root);
+                NODISCARD JobHandle* GetRoot() const;
+                void SetContinuation(std::coroutine_handle<> continuation);
+
+            private:
+                // Scheduled job the task (and every task it awaits) runs under. Completes once the outermost task does.
+                JobHandle* root_ = nullptr;
+                std::coroutine_handle<> continuation_;
+        };
+
+        template <typename T>
+        class TaskPromise : public TaskPromiseBase {
+            public:
+                Task<T> get_return_object();
+                void return_value(T value);
+                NODISCARD T GetResult();
+
+            private:
+                std::optional<T> result_;
+        };
+
+        template <>
+        class TaskPromise<void> : public TaskPromiseBase {
+            public:
+                Task<void> get_return_object();
+                void return_void() const;
+                void GetResult() const;
+        };
+
+        // co_await on a Task. Starts the awaited task on the calling worker, under the same root job.
+        template <typename T>
+        class TaskAwaiter {
+            public:
+                explicit TaskAwaiter(std::coroutine_handle<TaskPromise<T>> coroutine);
+
+                NODISCARD bool await_ready() const noexcept;
+                template <typename Promise>
+                NODISCARD std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) const noexcept;
+                T await_resume() const;
+
+            private:
+                std::coroutine_handle<TaskPromise<T>> coroutine_;
+        };
+
+        // Coroutine job, for example:
+        //     Task<int> Load(JobSystem* jobSystem) {
+        //         co_await jobSystem->Schedule([]() { ... });
+        //         co_return 42;
+        //     }
+        //     Task<> Update(JobSystem* jobSystem) {
+        //         int value = co_await Load(jobSystem);
+        //     }
+        //     jobSystem->Schedule(Update(jobSystem)).Complete();
+        // Awaiting a ManagedJobHandle suspends the task without blocking its worker, the task resumes on the worker
+        // that completes the awaited job. Awaiting a Task runs it right away on the same worker. Thread local state
+        // must not be kept across co_await.
+        template <typename T = void>
+        class Task {
+            public:
+                using promise_type = TaskPromise<T>;
+
+                Task(Task&& other) noexcept;
+                Task& operator=(Task&& other) noexcept;
+                ~Task();
+
+                // Tasks should not be copied, they own their coroutine frame.
+                Task(const Task& other) = delete;
+                Task& operator=(const Task& other) = delete;
+
+                // Tasks can only be awaited once, as temporaries (co_await Load()) or moved (co_await std::move(task)).
+                TaskAwaiter<T> operator co_await() && noexcept;
+
+            private:
+                friend class TaskPromise<T>;
+                explicit Task(std::coroutine_handle<promise_type> coroutine);
+
+                friend class CoroutineJob;
+                std::coroutine_handle<promise_type> coroutine_;
+        };
+
+        // co_await on a ManagedJobHandle. Stages the job, like ManagedJobHandle::Complete.
+        class JobAwaiter {
+            public:
+                explicit JobAwaiter(const ManagedJobHandle& handle);
+
+                NODISCARD bool await_ready() const;
+                template <typename Promise>
+                void await_suspend(std::coroutine_handle<Promise> coroutine) const;
+                void await_resume() const noexcept;
+
+            private:
+                // Resumes the task once the job completes, through a job scheduled as a child of the task's root job.
+                void Suspend(JobHandle* root, std::coroutine_handle<> coroutine) const;
+
+                JobHandle* jobHandle_;
+                std::uint32_t generation_;
+        };
+
+        JobAwaiter operator co_await(const ManagedJobHandle& handle);
+
+        // Root job of JobSystem::Schedule(Task<>). Owns the task, which stays alive until it completes.
+        class CoroutineJob : public IJob {
+            public:
+                CoroutineJob(JobHandle* root, Task<void> task);
+                void Execute() override;
+
+            private:
+                JobHandle* root_;
+                Task<void> task_;
+        };
+
+        // Resumes a task suspended on a job, scheduled as a child of the task's root job.
+        class ResumeCoroutineJob : public IJob {
+            public:
+                explicit ResumeCoroutineJob(std::coroutine_handle<> coroutine);
+                void Execute() override;
+
+            private:
+                std::coroutine_handle<> coroutine_;
+        };
+
+    }
+}
+
+#endif //SPARK_TASK_H
@@ -0,0 +1,88 @@
+
+#ifndef SPARK_TASK_TPP
+#define SPARK_TASK_TPP
+
+namespace Spark::Job {
+
+    template <typename T>
+    Task<T> TaskPromise<T>::get_return_object() {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    template <typename T>
+    void TaskPromise<T>::return_value(T value) {
+        result_.emplace(std::move(value));
+    }
+
+    template <typename T>
+    T TaskPromise<T>::GetResult() {
+        return std::move(*result_);
+    }
+
+    template <typename T>
+    TaskAwaiter<T>::TaskAwaiter(std::coroutine_handle<TaskPromise<T>> coroutine) : coroutine_(coroutine) {
+    }
+
+    template <typename T>
+    bool TaskAwaiter<T>::await_ready() const noexcept {
+        return false;
+    }
+
+    template <typename T>
+    template <typename Promise>
+    std::coroutine_handle<> TaskAwaiter<T>::await_suspend(std::coroutine_handle<Promise> awaiting) const noexcept {
+        static_assert(std::is_base_of_v<TaskPromiseBase, Promise>, "Tasks can only be awaited from other tasks.");
+
+        // Awaited task runs under the root job of the awaiting task.
+        coroutine_.promise().SetRoot(awaiting.promise().GetRoot());
+        coroutine_.promise().SetContinuation(awaiting);
+        return coroutine_;
+    }
+
+    template <typename T>
+    T TaskAwaiter<T>::await_resume() const {
+        return coroutine_.promise().GetResult();
+    }
+
+    template <typename T>
+    Task<T>::Task(std::coroutine_handle<promise_type> coroutine) : coroutine_(coroutine) {
+    }
+
+    template <typename T>
+    Task<T>::Task(Task&& other) noexcept : coroutine_(std::exchange(other.coroutine_, nullptr)) {
+    }
+
+    template <typename T>
+    Task<T>& Task<T>::operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (coroutine_) {
+                coroutine_.destroy();
+            }
+
+            coroutine_ = std::exchange(other.coroutine_, nullptr);
+        }
+
+        return *this;
+    }
+
+    template <typename T>
+    Task<T>::~Task() {
+        if (coroutine_) {
+            coroutine_.destroy();
+        }
+    }
+
+    template <typename T>
+    TaskAwaiter<T> Task<T>::operator co_await() && noexcept {
+        return TaskAwaiter<T>(coroutine_);
+    }
+
+    template <typename Promise>
+    void JobAwaiter::await_suspend(std::coroutine_handle<Promise> coroutine) const {
+        static_assert(std::is_base_of_v<TaskPromiseBase, Promise>, "Jobs can only be awaited from tasks.");
+        Suspend(coroutine.promise().GetRoot(), coroutine);
+    }
+
+}
+
+#endif //SPARK_TASK_TPP
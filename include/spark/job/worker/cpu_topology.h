@@ -0,0 +1,44 @@
+
+#ifndef SPARK_CPU_TOPOLOGY_H
+#define SPARK_CPU_TOPOLOGY_H
+
+#include "spark/utility.h"
+
+namespace Spark {
+    namespace Job {
+
+        struct LogicalProcessor {
+            unsigned id = 0;          // Index of the processor in the OS (cpuN).
+            unsigned package = 0;     // Physical socket.
+            unsigned core = 0;        // Physical core within the package.
+            unsigned cacheGroup = 0;  // Processors with the same cache group share a last level cache.
+            bool smtSibling = false;  // Set for every hardware thread of a core but the first.
+        };
+
+        // Processors the process is allowed to run on, read from /sys/devices/system/cpu.
+        class CpuTopology {
+            public:
+                // Falls back to a uniform topology of hardware_concurrency processors if sysfs cannot be read.
+                NODISCARD static CpuTopology Detect();
+
+                // Processors 0 to numProcessors - 1, all sharing one cache.
+                NODISCARD static CpuTopology Uniform(unsigned numProcessors);
+
+                explicit CpuTopology(std::vector<LogicalProcessor> processors);
+
+                NODISCARD const std::vector<LogicalProcessor>& GetProcessors() const;
+                NODISCARD unsigned GetNumCacheGroups() const;
+
+                // Processors in the order workers should be placed on them: grouped by cache, SMT siblings last (or
+                // left out entirely).
+                NODISCARD std::vector<LogicalProcessor> GetPlacementOrder(bool skipSmtSiblings) const;
+
+            private:
+                std::vector<LogicalProcessor> processors_;
+                unsigned numCacheGroups_;
+        };
+
+    }
+}
+
+#endif //SPARK_CPU_TOPOLOGY_H
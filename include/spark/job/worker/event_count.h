@@ -0,0 +1,44 @@
+
+#ifndef SPARK_EVENT_COUNT_H
+#define SPARK_EVENT_COUNT_H
+
+#include "spark/utility.h"
+
+namespace Spark {
+    namespace Job {
+
+        // Lets idle workers sleep without missing notifications sent between checking for work and going to sleep.
+        // Waiting is split into two phases:
+        //     1. PrepareWait() announces the intent to sleep and returns a key.
+        //     2. The caller checks the sleep condition again (any work available?), then either calls CancelWait()
+        //        or CommitWait(key). CommitWait returns immediately if a notification arrived after PrepareWait().
+        // Notifying threads only take the lock when a thread is actually waiting.
+        class EventCount {
+            public:
+                EventCount();
+                ~EventCount();
+
+                NODISCARD std::uint64_t PrepareWait();
+                void CancelWait();
+                void CommitWait(std::uint64_t key);
+                // Returns false if the wait timed out before a notification arrived.
+                bool CommitWait(std::uint64_t key, std::chrono::microseconds timeout);
+
+                // Returns true if a waiting thread was notified.
+                bool NotifyOne();
+                void NotifyAll();
+
+                NODISCARD unsigned GetNumWaiters() const;
+
+            private:
+                std::atomic<std::uint64_t> epoch_;
+                std::atomic<unsigned> numWaiters_;
+
+                std::mutex mutex_;
+                std::condition_variable condition_;
+        };
+
+    }
+}
+
+#endif //SPARK_EVENT_COUNT_H
@@ -0,0 +1,89 @@
+
+#ifndef SPARK_FIBER_H
+#define SPARK_FIBER_H
+
+#include "spark/utility.h"
+#include "spark/job/job_storage.h"
+
+#if !defined(__x86_64__)
+    #include <ucontext.h>
+#endif
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+
+        // Execution context with its own stack that a job runs on in fiber mode. Fibers are resumed like stackful
+        // coroutines: Resume switches from the calling worker to the fiber, and control comes back once the job either
+        // completes or suspends itself (JobSystem::WaitFor). A suspended fiber can be resumed from any thread.
+        class Fiber {
+            public:
+                explicit Fiber(std::size_t stackSize);
+                ~Fiber();
+
+                // Fibers should not be copied or moved, their context points into their own stack.
+                Fiber(const Fiber& other) = delete;
+                Fiber& operator=(const Fiber& other) = delete;
+
+                // Assigns the job the next Resume starts executing.
+                void Start(JobHandle* jobHandle, JobStorage* job);
+
+                // Runs the job until it completes (returns true) or suspends (returns false).
+                bool Resume();
+
+                // Called from the job running on this fiber. Returns once the fiber is resumed, possibly on another thread.
+                void Suspend();
+
+                NODISCARD JobHandle* GetJobHandle() const;
+
+            private:
+                static void Run(unsigned high, unsigned low);
+                void SwitchTo(bool toFiber);
+
+                // x86-64 switches stacks directly (saved stack pointers), ucontext is the portable fallback. swapcontext
+                // saves and restores the signal mask with a system call on every switch.
+                #if defined(__x86_64__)
+                    void* context_;
+                    void* callerContext_;
+                #else
+                    ucontext_t context_;
+                    ucontext_t callerContext_;
+                #endif
+
+                void* stack_;
+                std::size_t stackSize_;
+
+                JobHandle* jobHandle_;
+                JobStorage* job_;
+                bool isFinished_;
+
+                // ThreadSanitizer needs to know about stack switches.
+                void* sanitizerFiber_;
+                void* sanitizerCallerFiber_;
+        };
+
+        // Preallocated fibers shared by all workers. Workers take and return fibers in batches (see Worker) to keep the
+        // lock off the path of every job.
+        class FiberPool {
+            public:
+                FiberPool(unsigned numFibers, std::size_t stackSize);
+                ~FiberPool();
+
+                // Moves up to 'count' fibers into 'fibers'. Returns the number of fibers moved.
+                unsigned Acquire(std::vector<Fiber*>& fibers, unsigned count);
+                void Release(Fiber* fiber);
+
+                NODISCARD unsigned GetNumFibers() const;
+
+            private:
+                std::vector<std::unique_ptr<Fiber>> fibers_;
+
+                std::mutex mutex_;
+                std::vector<Fiber*> available_;
+        };
+
+    }
+}
+
+#endif //SPARK_FIBER_H
@@ -0,0 +1,60 @@
+
+#ifndef SPARK_INJECTION_QUEUE_H
+#define SPARK_INJECTION_QUEUE_H
+
+#include "spark/utility.h"
+#include "spark/job/job_definitions.h"
+#include <deque>
+
+namespace Spark {
+    namespace Job {
+
+        class JobHandle;
+
+        // Bounded lock-free multi-producer multi-consumer queue (Vyukov) for jobs submitted from threads outside the
+        // worker pool. Workers poll it once their own deques are empty. Each slot carries a sequence number that tells
+        // producers and consumers whether the slot is free for the current lap, so both ends only contend on their own
+        // position counter.
+        class InjectionQueue {
+            public:
+                explicit InjectionQueue(std::size_t capacity = JOB_INJECTION_QUEUE_CAPACITY);
+                ~InjectionQueue();
+
+                // Returns false if the queue is full.
+                NODISCARD bool TryPush(JobHandle* jobHandle);
+
+                // Jobs pushed past capacity under OverflowPolicy::GROW. Taken by TryPop once the queue runs empty.
+                void PushOverflow(JobHandle* jobHandle);
+
+                // Returns nullptr if the queue (and the overflow) is empty.
+                NODISCARD JobHandle* TryPop();
+
+                // Approximate.
+                NODISCARD std::size_t GetSize() const;
+                NODISCARD bool IsEmpty() const;
+
+                // Injection queues should not be copied.
+                InjectionQueue& operator=(const InjectionQueue& other) = delete;
+                InjectionQueue(const InjectionQueue& other) = delete;
+
+            private:
+                struct Slot {
+                    std::atomic<std::size_t> sequence;
+                    JobHandle* jobHandle;
+                };
+
+                std::unique_ptr<Slot[]> slots_;
+                std::size_t mask_;
+
+                alignas(64) std::atomic<std::size_t> enqueuePosition_;
+                alignas(64) std::atomic<std::size_t> dequeuePosition_;
+
+                alignas(64) std::atomic<std::size_t> numOverflowJobs_; // Size of the overflow, written under its lock.
+                std::mutex overflowMutex_;
+                std::deque<JobHandle*> overflow_;
+        };
+
+    }
+}
+
+#endif //SPARK_INJECTION_QUEUE_H
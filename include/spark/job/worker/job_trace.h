@@ -0,0 +1,132 @@
+
+#ifndef SPARK_JOB_TRACE_H
+#define SPARK_JOB_TRACE_H
+
+#include "spark/utility.h"
+#include "spark/job/job_definitions.h"
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+// Records a trace event on the calling worker (threads outside the worker pool are not traced). Compiles to nothing
+// unless the engine is built with SPARK_JOB_TRACING.
+#ifdef SPARK_JOB_TRACING
+    #define SP_JOB_TRACE(type, argument) ::Spark::Job::Worker::Trace(type, argument)
+#else
+    #define SP_JOB_TRACE(type, argument)
+#endif
+
+namespace Spark {
+    namespace Job {
+
+        enum class TraceEventType : std::uint32_t {
+            JOB_BEGIN,      // Job starts or resumes executing. Argument: JobPriority.
+            JOB_END,        // Job finished executing.
+            JOB_SUSPEND,    // Job suspended its fiber in WaitFor.
+            RELEASE,        // Completed job re-queued the jobs waiting on it. Argument: number of waiting jobs.
+            STEAL,          // Job stolen, stamped when the next event (the stolen job starting) is. Argument: victim worker.
+            STEAL_FAILED,   // Consecutive sweeps over all victims that found nothing. Argument: number of sweeps.
+            PARK,           // Thread went to sleep on the idle event.
+            WAKE
+        };
+
+        struct TraceEvent {
+            std::uint64_t timestamp;
+            TraceEventType type;
+            std::uint32_t argument;
+        };
+
+        namespace Internal {
+
+            // Time stamp counter where available, nanoseconds since an arbitrary point otherwise.
+            NODISCARD inline std::uint64_t ReadTimestamp() {
+                #if defined(__x86_64__) || defined(__i386__)
+                    return __rdtsc();
+                #else
+                    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+                #endif
+            }
+
+            // Nanoseconds per timestamp tick, measured over the lifetime of the process so far.
+            NODISCARD double GetTimestampPeriod();
+
+        }
+
+        // Ring buffer of the most recent trace events of one worker. Only the owning thread records events, without
+        // synchronization beyond a release store. Once full, the oldest events are overwritten. Recording is inline,
+        // an event costs one timestamp read and one store.
+        class TraceBuffer {
+            public:
+                explicit TraceBuffer(std::size_t capacity = JOB_TRACE_BUFFER_SIZE);
+                ~TraceBuffer();
+
+                // Owner only. Consecutive STEAL_FAILED events are counted and only written as one event once the
+                // streak ends (the next event of another type), published events are never modified. A STEAL is
+                // written along with the next event and shares its timestamp, so a stolen job reads the timestamp
+                // counter twice, not three times.
+                void Record(TraceEventType type, std::uint32_t argument);
+
+                // Any thread. Events recorded while the snapshot is taken may be missing or overwritten, take snapshots
+                // while the job system is idle for a consistent trace. A streak of failed steals still in progress is
+                // not included.
+                NODISCARD std::vector<TraceEvent> GetEvents() const;
+
+            private:
+                void Publish(std::uint64_t timestamp, TraceEventType type, std::uint32_t argument);
+
+                std::unique_ptr<TraceEvent[]> events_;
+                std::size_t mask_;
+                std::atomic<std::uint64_t> numEvents_;
+
+                // Events not yet written, owner only.
+                std::uint64_t failedStealTimestamp_;
+                std::uint32_t numFailedSteals_;
+                std::uint32_t stealVictim_; // Victim + 1, 0 if there is no pending steal.
+        };
+
+        // Writes the events of every worker (buffer i is worker i) in the Chrome trace event format, which
+        // chrome://tracing and Perfetto can open.
+        void WriteChromeTrace(std::ostream& stream, const std::vector<std::vector<TraceEvent>>& workerEvents);
+
+        inline void TraceBuffer::Record(TraceEventType type, std::uint32_t argument) {
+            // Idle workers fail to steal over and over, a streak of failures is stamped with its first event.
+            if (type == TraceEventType::STEAL_FAILED) {
+                if (numFailedSteals_ == 0) {
+                    failedStealTimestamp_ = Internal::ReadTimestamp();
+                }
+
+                numFailedSteals_ += argument;
+                return;
+            }
+
+            if (numFailedSteals_ != 0) {
+                Publish(failedStealTimestamp_, TraceEventType::STEAL_FAILED, numFailedSteals_);
+                numFailedSteals_ = 0;
+            }
+
+            if (type == TraceEventType::STEAL) {
+                stealVictim_ = argument + 1;
+                return;
+            }
+
+            std::uint64_t timestamp = Internal::ReadTimestamp();
+            if (stealVictim_ != 0) {
+                Publish(timestamp, TraceEventType::STEAL, stealVictim_ - 1);
+                stealVictim_ = 0;
+            }
+
+            Publish(timestamp, type, argument);
+        }
+
+        inline void TraceBuffer::Publish(std::uint64_t timestamp, TraceEventType type, std::uint32_t argument) {
+            std::uint64_t numEvents = numEvents_.load(std::memory_order_relaxed);
+            events_[numEvents & mask_] = TraceEvent { timestamp, type, argument };
+            numEvents_.store(numEvents + 1, std::memory_order_release);
+        }
+
+    }
+}
+
+#endif //SPARK_JOB_TRACE_H
@@ -3,38 +3,69 @@
 #define SPARK_WORK_STEALING_QUEUE_H
 
 #include "spark/utility.h"
-#include "spark/job/job_types.h"
 #include "spark/job/job_handle.h"
 #include "spark/job/job_definitions.h"
 
 namespace Spark {
     namespace Job {
 
+        // Lock-free Chase-Lev work-stealing deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+        // Push and Pop may only be called by the owning worker and operate on the bottom of the deque.
+        // Steal may be called by any thread and operates on the top of the deque.
         class WorkStealingQueue {
             public:
-                explicit WorkStealingQueue(std::size_t capacity);
+                explicit WorkStealingQueue(std::size_t capacity = WORKER_JOB_CAPACITY);
                 ~WorkStealingQueue();
 
-                template <typename T, typename ...Args>
-                bool Emplace(JobHandle* handle, Args&& ...args);
-                bool Push(JobHandle* handle, const JobVariant& jobVariant);
+                // Owner only.
+                void Push(JobHandle* handle);
 
-                std::optional<JobEntry> Pop();
-                std::optional<JobEntry> Steal();
+                // Pushes 'count' jobs, made visible to thieves with a single publish. Owner only.
+                void Push(JobHandle* const* handles, std::size_t count);
+                NODISCARD JobHandle* Pop();
+
+                // Any thread. Returns nullptr if the queue is empty or the steal lost a race with another thread.
+                NODISCARD JobHandle* Steal();
+
+                NODISCARD std::size_t GetSize() const;
+                NODISCARD bool IsEmpty() const;
+
+                // Work stealing queues should not be copied.
+                WorkStealingQueue& operator=(const WorkStealingQueue& other) = delete;
+                WorkStealingQueue(const WorkStealingQueue& other) = delete;
 
             private:
-                std::size_t capacity_;
-                std::size_t mask_;
+                // Circular array of job handles. Slots are atomic so a thief can read a slot the owner is concurrently
+                // writing to without a data race; the top_ CAS decides which value is kept.
+                class RingBuffer {
+                    public:
+                        explicit RingBuffer(std::int64_t capacity);
+                        ~RingBuffer();
+
+                        NODISCARD std::int64_t GetCapacity() const;
+
+                        void Store(std::int64_t index, JobHandle* handle);
+                        NODISCARD JobHandle* Load(std::int64_t index) const;
 
-                JobEntry* collection_;
-                std::mutex mutex_;
-                int bottom_;
-                int top_;
+                        // Returns a buffer with double the capacity containing elements in the range [top, bottom).
+                        NODISCARD RingBuffer* Grow(std::int64_t bottom, std::int64_t top) const;
+
+                    private:
+                        std::int64_t capacity_;
+                        std::int64_t mask_;
+                        std::atomic<JobHandle*>* slots_;
+                };
+
+                alignas(64) std::atomic<std::int64_t> top_;
+                alignas(64) std::atomic<std::int64_t> bottom_;
+                std::atomic<RingBuffer*> buffer_;
+
+                // Thieves may still be reading from a buffer after it has been replaced. Retired buffers are kept alive
+                // until the queue is destroyed (total retired memory is bounded by the size of the current buffer).
+                std::vector<RingBuffer*> retiredBuffers_;
         };
 
     }
 }
 
-#include "spark/job/worker/work_stealing_queue.tpp"
-
 #endif //SPARK_WORK_STEALING_QUEUE_H
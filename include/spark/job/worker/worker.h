@@ -4,37 +4,203 @@
 
 #include "spark/utility.h"
 #include "spark/job/worker/work_stealing_queue.h"
+#include "spark/job/worker/fiber.h"
+#include "spark/job/worker/job_trace.h"
 #include "spark/job/job_definitions.h"
 
 namespace Spark {
     namespace Job {
 
+        class WorkerPool;
+
         class Worker {
             public:
                 Worker();
                 ~Worker();
 
+                // Starts the worker thread. A previously terminated worker can be started again once IsRunning returns
+                // false.
+                void Start();
+
+                // Makes the calling thread the owner of this worker without starting a worker thread (main thread).
+                void AttachToCurrentThread();
+
+                // Waits for the worker thread to exit, if there is one.
                 void Terminate();
 
-                template <typename T, typename... Args>
-                void Schedule(JobHandle* jobHandle, Args&& ...args);
+                // Stops the worker loop without waiting for the worker thread to exit.
+                void RequestTermination();
+
+                // True from Start until the worker thread has left its loop.
+                NODISCARD bool IsRunning() const;
+
+                // Pushes directly onto the worker deque for the job's priority when called from this worker's thread,
+                // otherwise hands the job off through the mailbox (only the owning thread may push onto a work-stealing
+                // deque). Jobs must have no pending dependencies. Threads outside the worker pool submit through the
+                // injection queues of the worker pool instead.
+                void Submit(JobHandle* jobHandle);
+
+                // Submits 'count' jobs of the same priority with one publish: a single push onto the deque, or a single
+                // mailbox lock from other threads.
+                void Submit(JobHandle* const* jobHandles, std::size_t count);
+
+                // Returns true if this worker has jobs of the first numPriorities priorities that can be stolen, or any
+                // jobs waiting in its mailbox.
+                NODISCARD bool HasQueuedJobs(unsigned numPriorities = NUM_JOB_PRIORITIES) const;
+
+                // Approximate.
+                NODISCARD std::size_t GetNumQueuedJobs() const;
+
+                NODISCARD IdleStatistics GetIdleStatistics() const;
+                NODISCARD WorkerStatistics GetStatistics() const;
+
+                // Workers to steal from, never including this worker. The first numLocalVictims share a cache with
+                // this worker and are tried first.
+                void SetVictims(std::vector<Worker*> victims, std::size_t numLocalVictims, StealPolicy stealPolicy);
+
+                // Restricts the worker thread to the given processor. Returns false if the OS rejected the request.
+                bool SetAffinity(unsigned processor);
+
+                // Enables fiber mode, nullptr runs every job on the stack of the worker.
+                void SetFiberPool(FiberPool* fiberPool);
+
+                // Worker whose thread is the calling thread, nullptr for threads outside the worker pool.
+                NODISCARD static Worker* GetCurrentWorker();
+
+                #ifdef SPARK_JOB_TRACING
+                    // Records an event in the trace buffer of the calling worker, use SP_JOB_TRACE.
+                    static void Trace(TraceEventType type, std::uint32_t argument);
+
+                    // Oldest first, see TraceBuffer::GetEvents.
+                    NODISCARD std::vector<TraceEvent> GetTraceEvents() const;
+                #endif
 
             private:
+                friend class JobHandle;
+                friend class WorkerPool;
+                // Position in the worker pool, identifies the worker in traces.
+                void SetIndex(unsigned index);
+
+                // Pops from this worker's own deque (after draining its mailbox), taking the job with the earliest deadline
+                // of the highest priority that has any ahead of the jobs of that priority and below. Then takes jobs
+                // submitted from outside the worker pool, and steals from other workers when there are none. Only jobs of the first numPriorities priorities are taken from queues, see
+                // WorkerPool::GetNumRunnablePriorities. Called from the owning thread only.
+                NODISCARD JobHandle* GetJob(unsigned numPriorities);
+
+                // Takes a job from the top of the highest priority non-empty deque, or out of the mailbox when all
+                // deques are empty. Callable from any thread.
+                NODISCARD JobHandle* Steal(unsigned numPriorities = NUM_JOB_PRIORITIES);
+
+                // Runs the job on a fiber when fiber mode is enabled and a fiber is available, resuming the fiber of a
+                // job that was suspended in WaitFor.
+                static void ExecuteJob(JobHandle* jobHandle);
+
+                // Completes the job once it and all of its children have finished, walking up to its parent.
+                static void FinishJob(JobHandle* jobHandle);
+
+                friend class JobSystem;
+                // Suspends the fiber of the calling job until the job completes. Falls back to JobHandle::Complete when
+                // the calling job is not running on a fiber.
+                static void WaitFor(JobHandle* jobHandle, std::uint32_t generation);
+
+                // Fibers are taken from / returned to the cache of the calling worker. Threads outside the worker pool
+                // return fibers to the fiber pool directly.
+                NODISCARD Fiber* AcquireFiber();
+                static void ReleaseFiber(Fiber* fiber);
+
                 void Distribute();
 
-                std::optional<JobEntry> GetJob();
-                void ExecuteJob(JobEntry& job);
-                void PutJobOnWaitlist(JobEntry& job);
+                // Spin-then-park: called after an iteration of Distribute that did not execute a job.
+                void Idle();
+
+                // Lets an elastic pool sample its load every 64 jobs the owning thread runs, from Distribute or while
+                // helping in JobHandle::Complete (the main thread runs most of its own jobs there).
+                void CountExecutedJob(WorkerPool& workerPool);
+
+                void DrainMailbox();
+
+                // Called by the owning thread after pushing onto the deque.
+                void UpdatePeakQueueDepth(const WorkStealingQueue& deque);
+
+                // Called by the owning thread once it wakes up, also from JobHandle::Complete.
+                void AddIdleTime(std::chrono::steady_clock::time_point parkTime);
+
+                // Tries each victim in [begin, end) once, starting at a random one.
+                NODISCARD JobHandle* StealFromVictims(std::size_t begin, std::size_t end, unsigned numPriorities);
+
+                // Steals a job and moves up to half of the rest of the victim's highest priority queue onto this worker.
+                NODISCARD JobHandle* StealBatch(Worker* victim, unsigned numPriorities);
+                NODISCARD JobHandle* StealFromMailbox(unsigned numPriorities);
+
+                // Pops from the highest priority non-empty deque, unless a lower priority deque has been passed over
+                // JOB_PRIORITY_AGING_LIMIT times.
+                NODISCARD JobHandle* PopJob(unsigned numPriorities);
+
+                // Counts the job towards the deadlines of the current frame, if it has a deadline.
+                static void RecordDeadline(const JobHandle* jobHandle);
+
+                // Constant initialized in the header, so inline readers (Trace) access it without a TLS wrapper call.
+                static inline thread_local Worker* currentWorker_ = nullptr;
+
+                // Fiber of the job the calling thread is executing, nullptr for jobs running on the stack of a thread.
+                static thread_local Fiber* currentFiber_;
+
+                // One deque per JobPriority.
+                WorkStealingQueue deques_[NUM_JOB_PRIORITIES];
+                unsigned numSkips_[NUM_JOB_PRIORITIES];
+
+                std::mutex mailboxMutex_;
+                std::vector<JobHandle*> mailbox_;
+                std::atomic<std::size_t> numMailJobs_; // Size of the mailbox, written under its lock.
+
+                std::vector<Worker*> victims_;
+                std::size_t numLocalVictims_;
+                StealPolicy stealPolicy_;
+                std::uint32_t randomState_;
+
+                FiberPool* fiberPool_;
+                std::vector<Fiber*> fiberCache_;
+
+                unsigned numIdleIterations_;
+                unsigned numExecutedJobs_;
+                std::atomic<std::uint64_t> numParks_;
+                std::atomic<std::uint64_t> numWakeups_;
+
+                // Written by the owning thread only (no read-modify-write needed), read by GetStatistics from any
+                // thread. Kept on a cache line of their own, away from the state other workers touch when stealing.
+                struct alignas(64) Counters {
+                    std::atomic<std::uint64_t> numExecutedJobs { 0 };
+                    std::atomic<std::uint64_t> numSkippedJobs { 0 };
+                    std::atomic<std::uint64_t> numSteals { 0 };
+                    std::atomic<std::uint64_t> numFailedSteals { 0 };
+                    std::atomic<std::uint64_t> numRequeuedJobs { 0 };
+                    std::atomic<std::uint64_t> idleTime { 0 };
+                    std::atomic<std::uint64_t> peakQueueDepth { 0 };
+                };
+
+                Counters counters_;
+
+                unsigned index_;
+
+                #ifdef SPARK_JOB_TRACING
+                    TraceBuffer traceBuffer_;
+                #endif
 
-                WorkStealingQueue deque_;
-                std::queue<JobEntry> waitlist_;
                 std::atomic<bool> workerThreadActive_;
+                std::atomic<bool> isRunning_;
                 std::thread workerThread_;
         };
 
+        #ifdef SPARK_JOB_TRACING
+            inline void Worker::Trace(TraceEventType type, std::uint32_t argument) {
+                Worker* worker = currentWorker_;
+                if (worker) {
+                    worker->traceBuffer_.Record(type, argument);
+                }
+            }
+        #endif
+
     }
 }
 
-#include "worker.tpp"
-
 #endif //SPARK_WORKER_H
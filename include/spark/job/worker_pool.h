@@ -4,23 +4,161 @@
 
 #include "spark/utility.h"
 #include "spark/job/worker/worker.h"
+#include "spark/job/worker/event_count.h"
+#include "spark/job/worker/injection_queue.h"
+#include "spark/job/worker/cpu_topology.h"
+#include "spark/job/worker_pool_configuration.h"
 
 namespace Spark {
     namespace Job {
 
+        // Worker 0 is the thread constructing the pool (main thread). It has its own deque, runs jobs while waiting in
+        // Complete, and gets its jobs stolen by the worker threads otherwise. Worker threads occupy workers
+        // [1, GetNumActiveWorkers()) and are started / retired at runtime for elastic pools. Retired workers stay
+        // visible to thieves until their queues run dry.
         class WorkerPool {
             public:
-                explicit WorkerPool(unsigned capacity = std::thread::hardware_concurrency());
+                // Pinned worker threads are placed cache by cache (see CpuTopology::GetPlacementOrder), leaving the first
+                // processor to the main thread.
+                explicit WorkerPool(const WorkerPoolConfiguration& configuration = WorkerPoolConfiguration(), const CpuTopology& topology = CpuTopology::Detect());
                 ~WorkerPool();
 
                 void Shutdown();
 
+                // Maximum number of workers, including the main thread.
                 NODISCARD unsigned GetCapacity() const;
+
+                // Number of workers currently running, including the main thread.
+                NODISCARD unsigned GetNumActiveWorkers() const;
+
+                // Random active worker thread (never the main thread).
                 NODISCARD Worker* GetRandomWorker() const;
 
+                NODISCARD const WorkerPoolConfiguration& GetConfiguration() const;
+                NODISCARD const CpuTopology& GetTopology() const;
+
+                // Park / wake transitions summed over all workers.
+                NODISCARD IdleStatistics GetIdleStatistics() const;
+
+                // Counters of every worker (including retired workers), indexed by worker.
+                NODISCARD std::vector<WorkerStatistics> GetWorkerStatistics() const;
+
+                // Counters summed over all workers.
+                NODISCARD WorkerStatistics GetStatistics() const;
+
+                // Frames are started and ended by a single thread (typically the main thread), see JobSystem::BeginFrame.
+                void BeginFrame(std::chrono::steady_clock::duration budget);
+                FrameReport EndFrame();
+
+                // End of the current frame's budget, time_point::max() when no frame is running.
+                NODISCARD std::chrono::steady_clock::time_point GetFrameEnd() const;
+
+                #ifdef SPARK_JOB_TRACING
+                    // Trace events of every worker, indexed by worker.
+                    NODISCARD std::vector<std::vector<TraceEvent>> GetTraceEvents() const;
+                #endif
+
             private:
+                friend class JobHandle;
+                // Submits a job with no pending dependencies to the calling worker, or to the injection queue for its
+                // priority if called from outside the worker pool. Jobs with a deadline go to the deadline queue.
+                void Submit(JobHandle* jobHandle);
+
+                // Takes an injected job of a higher priority than any job with a deadline, then a job with a deadline,
+                // then an injected job, then tries every worker once, starting at a random one. Used by threads outside
+                // the worker pool.
+                NODISCARD JobHandle* Steal();
+
+                friend class BatchJob;
+                // Splits the jobs (same priority, no pending dependencies) into one contiguous run per active worker
+                // thread. The calling worker's run goes straight onto its deque, other runs through the mailboxes.
+                void SubmitBatch(JobHandle* const* jobHandles, std::size_t count);
+
+                friend class Worker;
+                // Highest priority job (of the first numPriorities priorities) submitted from outside the worker pool,
+                // nullptr if there is none.
+                NODISCARD JobHandle* PopInjectedJob(unsigned numPriorities = NUM_JOB_PRIORITIES);
+
+                // Job with the earliest deadline of the highest priority (of the first numPriorities priorities) that has
+                // jobs with a deadline, nullptr if there is none.
+                NODISCARD JobHandle* PopDeadlineJob(unsigned numPriorities = NUM_JOB_PRIORITIES);
+
+                // Highest priority (of the first numPriorities priorities) with runnable jobs with a deadline,
+                // numPriorities if there is none. Jobs of higher priorities go ahead of them.
+                NODISCARD unsigned GetDeadlinePriority(unsigned numPriorities = NUM_JOB_PRIORITIES) const;
+
+                // Priorities worker threads take jobs of: all of them, or all but JobPriority::BACKGROUND while the
+                // current frame is at risk of going over budget.
+                NODISCARD unsigned GetNumRunnablePriorities() const;
+
+                // Called once a job with a deadline has finished.
+                void RecordDeadline(bool isMissed);
+
+                // Applies the overflow policy when the injection queue is full.
+                void Inject(JobHandle* jobHandle);
+
+                NODISCARD EventCount& GetIdleEvent();
+                NODISCARD bool HasQueuedJobs(unsigned numPriorities = NUM_JOB_PRIORITIES) const;
+
+                // Wakes up exactly one parked worker, if any.
+                void NotifyWorker();
+
+                // Samples the total queue depth (at most once every WORKER_POOL_SAMPLE_INTERVAL milliseconds) into its
+                // decaying average, and starts or retires a worker thread based on the average. Called by workers as
+                // they run jobs or go idle, does nothing for fixed size pools.
+                void Rebalance();
+
+                // nullptr unless fiber mode is enabled.
+                NODISCARD FiberPool* GetFiberPool() const;
+
+                // True for the last active worker thread of an elastic pool that is above its minimum size.
+                NODISCARD bool IsRetirementCandidate(const Worker* worker) const;
+
+                void StartWorker(unsigned index);
+
+                EventCount idleEvent_;
+                InjectionQueue injectionQueues_[NUM_JOB_PRIORITIES];
+                std::atomic<std::uint64_t> numNotifications_;
+
+                // Min-heap on the deadline (earliest deadline first).
+                struct DeadlineQueue {
+                    std::mutex mutex;
+                    std::vector<std::pair<std::chrono::steady_clock::time_point, JobHandle*>> jobs;
+                    std::atomic<std::size_t> numJobs { 0 };
+                };
+
+                // One per priority, deadlines only order jobs within their priority.
+                DeadlineQueue deadlineQueues_[NUM_JOB_PRIORITIES];
+
+                // Current frame. Times are steady_clock ticks, the risk time is the maximum value when no frame is
+                // running.
+                std::atomic<std::int64_t> frameRiskTime_;
+                std::atomic<std::int64_t> frameEndTime_;
+                mutable std::atomic<bool> isFrameAtRisk_;
+                std::chrono::steady_clock::time_point frameStart_;
+                std::chrono::steady_clock::duration frameBudget_;
+                std::uint64_t frameIndex_;
+                std::atomic<std::uint64_t> numFrameDeadlineJobs_;
+                std::atomic<std::uint64_t> numFrameMissedDeadlines_;
+
+                WorkerPoolConfiguration configuration_;
+                CpuTopology topology_;
+                std::vector<LogicalProcessor> processors_;
+
+                std::unique_ptr<FiberPool> fiberPool_;
+
                 unsigned workerCapacity_;
+                unsigned minActiveWorkers_;
+                std::atomic<unsigned> numActiveWorkers_;
                 Worker* workers_;
+
+                std::atomic<bool> isElastic_;
+                std::mutex rebalanceMutex_;
+                std::chrono::steady_clock::time_point nextSample_;
+                std::chrono::steady_clock::time_point lastSample_;
+                double averageQueueDepth_; // Weighted by the time between samples.
+                std::chrono::steady_clock::time_point nextGrowth_;
+                std::chrono::steady_clock::time_point lowDepthSince_;
         };
 
     }
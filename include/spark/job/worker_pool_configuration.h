@@ -0,0 +1,46 @@
+
+#ifndef SPARK_WORKER_POOL_CONFIGURATION_H
+#define SPARK_WORKER_POOL_CONFIGURATION_H
+
+#include "spark/job/job_definitions.h"
+
+namespace Spark {
+    namespace Job {
+
+        struct WorkerPoolConfiguration {
+            // Number of worker threads started with the pool, not counting the main thread (always worker 0).
+            // 0 starts maxWorkers worker threads.
+            unsigned numWorkers = 0;
+
+            // Bounds for the number of worker threads. A maxWorkers of 0 allows one worker thread per processor
+            // available under the pinning policy, minus one for the main thread.
+            unsigned minWorkers = 1;
+            unsigned maxWorkers = 0;
+
+            // Adds / retires worker threads at runtime based on sustained queue depth.
+            bool elastic = true;
+
+            ThreadPinning pinning = ThreadPinning::LOGICAL_CORES;
+            StealPolicy stealPolicy = StealPolicy::SINGLE;
+
+            // Jobs submitted from threads outside the worker pool go through a bounded injection queue, see
+            // OverflowPolicy for what happens when it is full.
+            OverflowPolicy overflowPolicy = OverflowPolicy::GROW;
+
+            // Runs jobs on fibers so they can suspend in JobSystem::WaitFor without blocking their worker. A numFibers
+            // of 0 allocates JOB_FIBERS_PER_WORKER fibers per worker. Jobs run on the stack of their worker when all
+            // fibers are in use.
+            bool fibers = false;
+            unsigned numFibers = 0;
+            std::size_t fiberStackSize = JOB_FIBER_STACK_SIZE;
+
+            // File reads / writes run on the I/O executor, never on a worker (see JobSystem::Read). Threads are only
+            // started when io_uring is disabled or not available.
+            bool ioUring = true;
+            unsigned numIoThreads = JOB_IO_THREADS;
+        };
+
+    }
+}
+
+#endif //SPARK_WORKER_POOL_CONFIGURATION_H
@@ -137,22 +137,6 @@ namespace Spark {
         }
     }
 
-    // Job system utility functionality.
-    namespace Job {
-        namespace Internal {
-
-            // Overload for accessing std::variant element using visitor paradigm.
-            template <typename ...Types>
-            struct Visitor : Types... {
-                using Types::operator()...;
-            };
-
-            template <typename ...Types>
-            Visitor(Types...) -> Visitor<Types...>;
-
-        }
-    }
-
 }
 
 #include "spark/utility.tpp"
@@ -0,0 +1,63 @@
+
+#ifndef SPARK_JOB_BENCH_H
+#define SPARK_JOB_BENCH_H
+
+#include <spark/job/job_system.h>
+
+namespace JobBench {
+
+    struct Options {
+        unsigned numWorkers = 0;      // Worker threads (excluding the main thread), 0 for one per hardware thread.
+        unsigned numSamples = 1000;   // Upper bound, benchmarks with expensive samples take fewer.
+        std::string benchmark;        // Runs a single benchmark if not empty.
+        std::string output;           // Writes to stdout if empty.
+    };
+
+    // Summary of a set of samples.
+    struct Statistics {
+        std::size_t numSamples = 0;
+        double min = 0.0;
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+
+        NODISCARD static Statistics FromSamples(std::vector<double> samples);
+
+        // Writes the members of a JSON object, without braces.
+        void Write(std::ostream& stream) const;
+    };
+
+    // Every benchmark writes one JSON value. Times are in nanoseconds unless noted otherwise.
+
+    // Jobs scheduled from the main thread and executed by the worker threads, in batches of 1000 jobs.
+    void ScheduleThroughput(const Options& options, std::ostream& stream);
+
+    // Schedule + Complete of a single empty job from the main thread.
+    void EmptyJobLatency(const Options& options, std::ostream& stream);
+
+    // Time from a job being pushed onto the main thread's queue until a worker thread steals and starts it. Includes
+    // waking up the worker when it was parked.
+    void StealLatency(const Options& options, std::ostream& stream);
+
+    // Chains of 1 to 10000 jobs, each depending on the one before, from staging to completion of the last job.
+    void DependencyChain(const Options& options, std::ostream& stream);
+
+    // Jobs with no dependencies joined by a single job depending on all of them.
+    void FanOutFanIn(const Options& options, std::ostream& stream);
+
+    // Owner pushing and popping against 0 to N thieves stealing, for the lock-free WorkStealingQueue and a
+    // mutex-protected deque (the queue it replaced). Does not use the job system.
+    void QueueThroughput(const Options& options, std::ostream& stream);
+
+    // ParallelFor over a fixed amount of work, in milliseconds, with the configured number of workers.
+    void ParallelFor(const Options& options, std::ostream& stream);
+
+    // ParallelFor from 1 to N worker threads. The job system cannot be reconfigured once running, every worker count
+    // runs in its own process (this executable with --benchmark parallel_for).
+    void ParallelForScaling(const Options& options, std::ostream& stream);
+
+}
+
+#endif // SPARK_JOB_BENCH_H
@@ -0,0 +1,527 @@
+
+#include <job_bench.h>
+#include <spark/job/worker/work_stealing_queue.h>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <numeric>
+#include <unistd.h>
+
+using namespace Spark::Job;
+using Clock = std::chrono::steady_clock;
+
+namespace JobBench {
+
+    namespace {
+
+        NODISCARD double ElapsedNanoseconds(Clock::time_point start, Clock::time_point end) {
+            return std::chrono::duration<double, std::nano>(end - start).count();
+        }
+
+        NODISCARD JobSystem* GetJobSystem() {
+            return Spark::Singleton<JobSystem>::GetInstance();
+        }
+
+        // Fewer samples for expensive measurements, at least 10.
+        NODISCARD unsigned GetNumSamples(const Options& options, std::size_t cost) {
+            return std::max(10u, static_cast<unsigned>(std::min<std::size_t>(options.numSamples, 100000 / std::max<std::size_t>(cost, 1))));
+        }
+
+        // Runs a few rounds before measuring, so worker threads are awake and handle chunks are allocated.
+        template <typename Function>
+        std::vector<double> Measure(unsigned numSamples, Function&& function) {
+            for (unsigned i = 0; i < std::max(numSamples / 10, 1u); ++i) {
+                function();
+            }
+
+            std::vector<double> samples;
+            samples.reserve(numSamples);
+
+            for (unsigned i = 0; i < numSamples; ++i) {
+                samples.emplace_back(function());
+            }
+
+            return samples;
+        }
+
+        // Stages every job, then completes the last one. Returns the time taken to complete.
+        NODISCARD double CompleteJobs(std::vector<ManagedJobHandle>& handles) {
+            Clock::time_point start = Clock::now();
+            handles.back().Complete();
+            double elapsed = ElapsedNanoseconds(start, Clock::now());
+
+            handles.clear();
+            return elapsed;
+        }
+
+
+        // Deque behind a single mutex, owner pops from the back and thieves steal from the front.
+        class MutexQueue {
+            public:
+                void Push(JobHandle* handle) {
+                    std::scoped_lock lock(mutex_);
+                    jobs_.push_back(handle);
+                }
+
+                NODISCARD JobHandle* Pop() {
+                    std::scoped_lock lock(mutex_);
+                    if (jobs_.empty()) {
+                        return nullptr;
+                    }
+
+                    JobHandle* handle = jobs_.back();
+                    jobs_.pop_back();
+                    return handle;
+                }
+
+                NODISCARD JobHandle* Steal() {
+                    std::scoped_lock lock(mutex_);
+                    if (jobs_.empty()) {
+                        return nullptr;
+                    }
+
+                    JobHandle* handle = jobs_.front();
+                    jobs_.pop_front();
+                    return handle;
+                }
+
+            private:
+                std::mutex mutex_;
+                std::deque<JobHandle*> jobs_;
+        };
+
+        // Owner pushes numJobs jobs, popping one after every third push, while thieves steal until every job is taken.
+        // Returns the time per job. Jobs are never dereferenced.
+        template <typename Queue>
+        NODISCARD double RunQueue(unsigned numThieves, std::size_t numJobs) {
+            Queue queue;
+            std::atomic<std::size_t> numTaken(0);
+            std::atomic<bool> isStarted(false);
+
+            std::vector<std::thread> thieves;
+            for (unsigned i = 0; i < numThieves; ++i) {
+                thieves.emplace_back([&queue, &numTaken, &isStarted, numJobs]() {
+                    while (!isStarted.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+
+                    while (numTaken.load(std::memory_order_relaxed) != numJobs) {
+                        if (queue.Steal()) {
+                            numTaken.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                });
+            }
+
+            Clock::time_point start = Clock::now();
+            isStarted.store(true, std::memory_order_release);
+
+            for (std::size_t i = 1; i <= numJobs; ++i) {
+                queue.Push(reinterpret_cast<JobHandle*>(i));
+
+                if (i % 3 == 0 && queue.Pop()) {
+                    numTaken.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            while (numTaken.load(std::memory_order_relaxed) != numJobs) {
+                if (queue.Pop()) {
+                    numTaken.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            double elapsed = ElapsedNanoseconds(start, Clock::now());
+            for (std::thread& thief : thieves) {
+                thief.join();
+            }
+
+            return elapsed / static_cast<double>(numJobs);
+        }
+
+    }
+
+    Statistics Statistics::FromSamples(std::vector<double> samples) {
+        Statistics statistics;
+        if (samples.empty()) {
+            return statistics;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        // Nearest rank.
+        auto percentile = [&samples](double rank) {
+            std::size_t index = static_cast<std::size_t>(std::ceil(rank * static_cast<double>(samples.size())));
+            return samples[std::clamp<std::size_t>(index, 1, samples.size()) - 1];
+        };
+
+        statistics.numSamples = samples.size();
+        statistics.min = samples.front();
+        statistics.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+        statistics.p50 = percentile(0.50);
+        statistics.p90 = percentile(0.90);
+        statistics.p99 = percentile(0.99);
+        statistics.max = samples.back();
+        return statistics;
+    }
+
+    void Statistics::Write(std::ostream& stream) const {
+        stream << std::fixed << std::setprecision(3)
+               << "\"samples\":" << numSamples
+               << ",\"min\":" << min
+               << ",\"mean\":" << mean
+               << ",\"p50\":" << p50
+               << ",\"p90\":" << p90
+               << ",\"p99\":" << p99
+               << ",\"max\":" << max;
+    }
+
+    void ScheduleThroughput(const Options& options, std::ostream& stream) {
+        JobSystem* jobSystem = GetJobSystem();
+        constexpr unsigned numJobs = 1000;
+
+        std::vector<double> samples = Measure(GetNumSamples(options, numJobs), [jobSystem]() {
+            std::atomic<unsigned> numExecuted(0);
+            Clock::time_point start = Clock::now();
+
+            // Handles are dropped right away, staging the jobs.
+            for (unsigned i = 0; i < numJobs; ++i) {
+                jobSystem->Schedule([&numExecuted]() {
+                    numExecuted.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+
+            while (numExecuted.load(std::memory_order_acquire) != numJobs) {
+                std::this_thread::yield();
+            }
+
+            return ElapsedNanoseconds(start, Clock::now()) / numJobs;
+        });
+
+        Statistics statistics = Statistics::FromSamples(samples);
+        stream << "{\"unit\":\"ns/job\",\"jobs\":" << numJobs << ",\"jobs_per_second\":" << std::fixed << std::setprecision(0) << 1e9 / statistics.p50 << ",";
+        statistics.Write(stream);
+        stream << "}";
+    }
+
+    void EmptyJobLatency(const Options& options, std::ostream& stream) {
+        JobSystem* jobSystem = GetJobSystem();
+
+        std::vector<double> samples = Measure(options.numSamples, [jobSystem]() {
+            Clock::time_point start = Clock::now();
+
+            ManagedJobHandle handle = jobSystem->Schedule([]() { });
+            handle.Complete();
+
+            return ElapsedNanoseconds(start, Clock::now());
+        });
+
+        stream << "{\"unit\":\"ns\",";
+        Statistics::FromSamples(samples).Write(stream);
+        stream << "}";
+    }
+
+    void StealLatency(const Options& options, std::ostream& stream) {
+        JobSystem* jobSystem = GetJobSystem();
+
+        std::vector<double> samples = Measure(options.numSamples, [jobSystem]() {
+            std::atomic<bool> isStarted(false);
+            Clock::time_point started;
+
+            ManagedJobHandle handle = jobSystem->Schedule([&isStarted, &started]() {
+                started = Clock::now();
+                isStarted.store(true, std::memory_order_release);
+            });
+
+            // The main thread only runs jobs in Complete, a worker thread has to steal the job.
+            Clock::time_point start = Clock::now();
+            handle = ManagedJobHandle();
+
+            while (!isStarted.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            return ElapsedNanoseconds(start, started);
+        });
+
+        stream << "{\"unit\":\"ns\",";
+        Statistics::FromSamples(samples).Write(stream);
+        stream << "}";
+    }
+
+    void DependencyChain(const Options& options, std::ostream& stream) {
+        JobSystem* jobSystem = GetJobSystem();
+        const char* separator = "";
+
+        stream << "[";
+
+        for (std::size_t depth : { 1, 10, 100, 1000, 10000 }) {
+            std::vector<double> samples = Measure(GetNumSamples(options, depth), [jobSystem, depth]() {
+                std::vector<ManagedJobHandle> handles;
+                handles.reserve(depth);
+
+                for (std::size_t i = 0; i < depth; ++i) {
+                    handles.emplace_back(jobSystem->Schedule([]() { }));
+
+                    if (i > 0) {
+                        handles[i].AddDependency(handles[i - 1]);
+                    }
+                }
+
+                return CompleteJobs(handles);
+            });
+
+            Statistics statistics = Statistics::FromSamples(samples);
+            stream << separator << "{\"depth\":" << depth << ",\"unit\":\"ns\",\"ns_per_job\":" << statistics.p50 / static_cast<double>(depth) << ",";
+            statistics.Write(stream);
+            stream << "}";
+            separator = ",";
+        }
+
+        stream << "]";
+    }
+
+    void FanOutFanIn(const Options& options, std::ostream& stream) {
+        JobSystem* jobSystem = GetJobSystem();
+        const char* separator = "";
+
+        stream << "[";
+
+        for (std::size_t width : { 10, 100, 1000, 10000 }) {
+            std::vector<double> samples = Measure(GetNumSamples(options, width), [jobSystem, width]() {
+                std::vector<ManagedJobHandle> handles;
+                handles.reserve(width + 1);
+
+                for (std::size_t i = 0; i < width; ++i) {
+                    handles.emplace_back(jobSystem->Schedule([]() { }));
+                }
+
+                ManagedJobHandle join = jobSystem->Schedule([]() { });
+                for (const ManagedJobHandle& handle : handles) {
+                    join.AddDependency(handle);
+                }
+
+                handles.emplace_back(std::move(join));
+                return CompleteJobs(handles);
+            });
+
+            stream << separator << "{\"width\":" << width << ",\"unit\":\"ns\",";
+            Statistics::FromSamples(samples).Write(stream);
+            stream << "}";
+            separator = ",";
+        }
+
+        stream << "]";
+    }
+
+    void QueueThroughput(const Options& options, std::ostream& stream) {
+        constexpr std::size_t numJobs = 100000;
+        unsigned maxThieves = std::max(std::thread::hardware_concurrency(), 4u) - 1;
+        const char* separator = "";
+
+        stream << "[";
+
+        for (unsigned numThieves = 0; numThieves <= maxThieves; numThieves = numThieves ? numThieves * 2 + 1 : 1) {
+            unsigned numSamples = GetNumSamples(options, 10000);
+            Statistics lockFree = Statistics::FromSamples(Measure(numSamples, [numThieves]() { return RunQueue<WorkStealingQueue>(numThieves, numJobs); }));
+            Statistics locked = Statistics::FromSamples(Measure(numSamples, [numThieves]() { return RunQueue<MutexQueue>(numThieves, numJobs); }));
+
+            stream << separator << "{\"thieves\":" << numThieves << ",\"unit\":\"ns/job\",\"speedup\":" << std::fixed << std::setprecision(3) << (lockFree.p50 > 0.0 ? locked.p50 / lockFree.p50 : 0.0) << ",\"chase_lev\":{";
+            lockFree.Write(stream);
+            stream << "},\"mutex\":{";
+            locked.Write(stream);
+            stream << "}}";
+            separator = ",";
+        }
+
+        stream << "]";
+    }
+
+    void ParallelFor(const Options& options, std::ostream& stream) {
+        JobSystem* jobSystem = GetJobSystem();
+
+        constexpr std::size_t numElements = 1u << 22u;
+        std::vector<float> values(numElements, 1.0f);
+
+        std::vector<double> samples = Measure(GetNumSamples(options, 1000), [jobSystem, &values]() {
+            Clock::time_point start = Clock::now();
+
+            ManagedJobHandle handle = jobSystem->ParallelFor(0, values.size(), 4096, [&values](std::size_t index) {
+                values[index] = std::sqrt(values[index] * values[index] + 1.0f);
+            });
+            handle.Complete();
+
+            return ElapsedNanoseconds(start, Clock::now()) / 1e6;
+        });
+
+        stream << "{\"workers\":" << jobSystem->GetNumActiveWorkers() << ",\"elements\":" << numElements << ",\"unit\":\"ms\",";
+        Statistics::FromSamples(samples).Write(stream);
+        stream << "}";
+    }
+
+    void ParallelForScaling(const Options& options, std::ostream& stream) {
+        unsigned hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+        unsigned maxWorkers = options.numWorkers ? options.numWorkers : hardwareThreads - 1;
+        double baseline = 0.0;
+        const char* separator = "";
+
+        // Commands run through the shell, /proc/self/exe would refer to the shell.
+        char executable[4096] = { };
+        if (readlink("/proc/self/exe", executable, sizeof(executable) - 1) <= 0) {
+            std::cerr << "ParallelFor scaling: failed to locate the benchmark executable." << std::endl;
+            stream << "[]";
+            return;
+        }
+
+        stream << "[";
+
+        for (unsigned numWorkers = 1; numWorkers <= maxWorkers; ++numWorkers) {
+            // The child writes its result to a file of its own, anything it logs to stdout (warnings, shutdown) is
+            // discarded.
+            char resultFile[] = "/tmp/spark_job_bench_XXXXXX";
+            int fileDescriptor = mkstemp(resultFile);
+            if (fileDescriptor < 0) {
+                std::cerr << "ParallelFor scaling: failed to create a result file." << std::endl;
+                break;
+            }
+
+            close(fileDescriptor);
+
+            std::string command = "\"" + std::string(executable) + "\" --benchmark parallel_for --workers " + std::to_string(numWorkers) + " --samples " + std::to_string(options.numSamples) + " --output \"" + resultFile + "\" > /dev/null";
+
+            std::string result;
+            if (std::system(command.c_str()) == 0) {
+                std::ifstream file(resultFile);
+                std::getline(file, result);
+            }
+
+            unlink(resultFile);
+
+            result.erase(result.find_last_not_of("\r\n") + 1);
+            if (result.empty()) {
+                std::cerr << "ParallelFor scaling: no result for " << numWorkers << " worker threads." << std::endl;
+                continue;
+            }
+
+            // Speedup of the median time relative to a single worker thread.
+            std::size_t p50 = result.find("\"p50\":");
+            double time = p50 != std::string::npos ? std::strtod(result.c_str() + p50 + 6, nullptr) : 0.0;
+            if (baseline == 0.0) {
+                baseline = time;
+            }
+
+            stream << separator << "{\"worker_threads\":" << numWorkers << ",\"speedup\":" << std::fixed << std::setprecision(3) << (time > 0.0 ? baseline / time : 0.0) << ",\"result\":" << result << "}";
+            separator = ",";
+        }
+
+        stream << "]";
+    }
+
+    void PrintUsage(std::ostream& stream, const char* program) {
+        stream << "Usage: " << program << " [--workers N] [--samples N] [--benchmark NAME] [--output FILE]" << std::endl;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    JobBench::Options options;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string argument = argv[i];
+
+        if (argument == "--help") {
+            JobBench::PrintUsage(std::cout, argv[0]);
+            return 0;
+        }
+
+        // Every other option takes a value.
+        if (i + 1 == argc) {
+            JobBench::PrintUsage(std::cerr, argv[0]);
+            return 1;
+        }
+
+        if (argument == "--workers") {
+            options.numWorkers = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (argument == "--samples") {
+            options.numSamples = std::max(1u, static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10)));
+        }
+        else if (argument == "--benchmark") {
+            options.benchmark = argv[i + 1];
+        }
+        else if (argument == "--output") {
+            options.output = argv[i + 1];
+        }
+        else {
+            JobBench::PrintUsage(std::cerr, argv[0]);
+            return 1;
+        }
+    }
+
+    // Fixed size pool, elastic resizing would skew the measurements.
+    WorkerPoolConfiguration configuration;
+    configuration.numWorkers = options.numWorkers;
+    configuration.minWorkers = options.numWorkers ? options.numWorkers : configuration.minWorkers;
+    configuration.maxWorkers = options.numWorkers;
+    configuration.elastic = false;
+    JobSystem::Configure(configuration);
+
+    using Benchmark = void (*)(const JobBench::Options&, std::ostream&);
+    const std::vector<std::pair<std::string, Benchmark>> benchmarks {
+        { "schedule_throughput", &JobBench::ScheduleThroughput },
+        { "empty_job_latency", &JobBench::EmptyJobLatency },
+        { "steal_latency", &JobBench::StealLatency },
+        { "dependency_chain", &JobBench::DependencyChain },
+        { "fan_out_fan_in", &JobBench::FanOutFanIn },
+        { "queue_throughput", &JobBench::QueueThroughput },
+        { "parallel_for", &JobBench::ParallelFor },
+        { "parallel_for_scaling", &JobBench::ParallelForScaling }
+    };
+
+    std::ostringstream stream;
+
+    if (!options.benchmark.empty()) {
+        auto benchmark = std::find_if(benchmarks.begin(), benchmarks.end(), [&options](const std::pair<std::string, Benchmark>& entry) {
+            return entry.first == options.benchmark;
+        });
+
+        if (benchmark == benchmarks.end()) {
+            std::cerr << "Unknown benchmark '" << options.benchmark << "'." << std::endl;
+            return 1;
+        }
+
+        benchmark->second(options, stream);
+    }
+    else {
+        JobSystem* jobSystem = Spark::Singleton<JobSystem>::GetInstance();
+        stream << "{\"hardware_threads\":" << std::thread::hardware_concurrency() << ",\"workers\":" << jobSystem->GetNumActiveWorkers() << ",\"benchmarks\":{";
+
+        const char* separator = "";
+        for (const std::pair<std::string, Benchmark>& benchmark : benchmarks) {
+            // Covered by the scaling results.
+            if (benchmark.first == "parallel_for") {
+                continue;
+            }
+
+            stream << separator << "\"" << benchmark.first << "\":";
+            benchmark.second(options, stream);
+            separator = ",";
+        }
+
+        stream << "}}";
+    }
+
+    if (options.output.empty()) {
+        std::cout << stream.str() << std::endl;
+    }
+    else {
+        std::ofstream file(options.output);
+        file << stream.str() << std::endl;
+
+        if (!file) {
+            std::cerr << "Failed to write '" << options.output << "'." << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef SPARK_JOB_TESTS_H
+#define SPARK_JOB_TESTS_H
+
+#include <spark/job/job_system.h>
+#include <cstdio>
+#include <cstdlib>
+
+// Reports the failed condition and exits with a non-zero status, failing the test.
+#define JOB_TEST_CHECK(condition, ...)                                                         \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: check '%s' failed: ", __FILE__, __LINE__, #condition); \
+            std::fprintf(stderr, __VA_ARGS__);                                                 \
+            std::fprintf(stderr, "\n");                                                        \
+            std::exit(1);                                                                      \
+        }                                                                                      \
+    } while (false)
+
+#endif // SPARK_JOB_TESTS_H
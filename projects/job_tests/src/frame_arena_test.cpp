@@ -0,0 +1,172 @@
+
+#include <job_tests.h>
+#include <new>
+
+using namespace Spark::Job;
+
+namespace {
+
+    std::atomic<std::uint64_t> numHeapAllocations(0);
+
+    // Too large for inline job storage, allocated from the frame arena of the scheduling thread.
+    struct OversizedJob : public IJob {
+        explicit OversizedJob(std::atomic<unsigned>* numExecuted) : numExecuted(numExecuted),
+                                                                     padding()
+                                                                     {
+            padding[0] = 1;
+        }
+
+        void Execute() override {
+            numExecuted->fetch_add(padding[0], std::memory_order_relaxed);
+        }
+
+        std::atomic<unsigned>* numExecuted;
+        unsigned char padding[200];
+    };
+
+    constexpr unsigned NUM_JOBS_PER_FRAME = 100;
+
+    // Schedules a frame of inline and oversized jobs into handles (reserved by the caller, so the vector does not
+    // allocate). Jobs are not joined through dependencies, growing the dependency lists of pooled handles would be
+    // counted as heap allocations.
+    void ScheduleFrame(JobSystem* jobSystem, std::atomic<unsigned>& numExecuted, const ManagedJobHandle* gate, std::vector<ManagedJobHandle>& handles) {
+        for (unsigned i = 0; i < NUM_JOBS_PER_FRAME; ++i) {
+            handles.emplace_back(jobSystem->Schedule([&numExecuted]() {
+                numExecuted.fetch_add(1, std::memory_order_relaxed);
+            }));
+            handles.emplace_back(jobSystem->Schedule<OversizedJob>(&numExecuted));
+
+            if (gate) {
+                handles[handles.size() - 2].AddDependency(*gate);
+                handles.back().AddDependency(*gate);
+            }
+        }
+    }
+
+    void CompleteFrame(std::vector<ManagedJobHandle>& handles) {
+        for (ManagedJobHandle& handle : handles) {
+            handle.Complete();
+        }
+
+        handles.clear();
+    }
+
+    // Once warmed up, frames make no heap allocations and every oversized job fits in the frame arena.
+    void SteadyState(JobSystem* jobSystem) {
+        std::vector<ManagedJobHandle> handles;
+        handles.reserve(2 * NUM_JOBS_PER_FRAME);
+
+        for (unsigned frame = 0; frame < 100; ++frame) {
+            std::uint64_t heapAllocations = numHeapAllocations.load(std::memory_order_relaxed);
+            std::uint64_t pooledBlocks = Internal::GetNumPooledJobBlocks();
+            std::atomic<unsigned> numExecuted(0);
+
+            jobSystem->BeginFrame();
+            ScheduleFrame(jobSystem, numExecuted, nullptr, handles);
+            CompleteFrame(handles);
+            ManagedJobHandle parallelFor = jobSystem->ParallelFor(0, 1000, 10, [&numExecuted](std::size_t) {
+                numExecuted.fetch_add(1, std::memory_order_relaxed);
+            });
+            parallelFor.Complete();
+            static_cast<void>(jobSystem->EndFrame());
+
+            JOB_TEST_CHECK(numExecuted.load() == 2 * NUM_JOBS_PER_FRAME + 1000, "frame %u executed %u jobs", frame, numExecuted.load());
+
+            if (frame >= 10) {
+                std::uint64_t numFrameAllocations = numHeapAllocations.load(std::memory_order_relaxed) - heapAllocations;
+                JOB_TEST_CHECK(numFrameAllocations == 0, "frame %u made %llu heap allocations", frame, static_cast<unsigned long long>(numFrameAllocations));
+            }
+
+            JOB_TEST_CHECK(Internal::GetNumPooledJobBlocks() == pooledBlocks, "frame %u fell back to the block pool", frame);
+        }
+    }
+
+    // Every frame is scheduled while the jobs of the previous frame have not run yet, blocks of two frames are always
+    // alive. Each frame must still be allocated from the arena.
+    void OverlappingFrames(JobSystem* jobSystem) {
+        std::uint64_t pooledBlocks = Internal::GetNumPooledJobBlocks();
+        std::atomic<unsigned> numExecuted(0);
+
+        ManagedJobHandle previousGate;
+        std::vector<ManagedJobHandle> previousHandles;
+        std::vector<ManagedJobHandle> handles;
+
+        for (unsigned frame = 0; frame < 200; ++frame) {
+            jobSystem->BeginFrame();
+
+            // Jobs of this frame wait on a gate that is only staged once the next frame has been scheduled.
+            ManagedJobHandle gate = jobSystem->Schedule([]() { });
+            ScheduleFrame(jobSystem, numExecuted, &gate, handles);
+
+            previousGate = ManagedJobHandle();
+            CompleteFrame(previousHandles);
+
+            previousGate = std::move(gate);
+            std::swap(previousHandles, handles);
+            static_cast<void>(jobSystem->EndFrame());
+        }
+
+        previousGate = ManagedJobHandle();
+        CompleteFrame(previousHandles);
+
+        JOB_TEST_CHECK(numExecuted.load() == 200 * 2 * NUM_JOBS_PER_FRAME, "executed %u jobs", numExecuted.load());
+        JOB_TEST_CHECK(Internal::GetNumPooledJobBlocks() == pooledBlocks, "%llu jobs fell back to the block pool", static_cast<unsigned long long>(Internal::GetNumPooledJobBlocks() - pooledBlocks));
+    }
+
+    // A block that outlives every frame (a long-running coroutine frame, a job that is never staged) only holds on to
+    // its own segment.
+    void PinnedBlock(JobSystem* jobSystem) {
+        std::atomic<unsigned> numPinnedExecuted(0);
+        jobSystem->BeginFrame();
+        ManagedJobHandle gate = jobSystem->Schedule([]() { });
+        ManagedJobHandle pinned = jobSystem->Schedule<OversizedJob>(&numPinnedExecuted);
+        pinned.AddDependency(gate);
+        static_cast<void>(jobSystem->EndFrame());
+
+        std::uint64_t pooledBlocks = Internal::GetNumPooledJobBlocks();
+
+        std::vector<ManagedJobHandle> handles;
+        for (unsigned frame = 0; frame < 200; ++frame) {
+            std::atomic<unsigned> numExecuted(0);
+            jobSystem->BeginFrame();
+            ScheduleFrame(jobSystem, numExecuted, nullptr, handles);
+            CompleteFrame(handles);
+            static_cast<void>(jobSystem->EndFrame());
+        }
+
+        JOB_TEST_CHECK(Internal::GetNumPooledJobBlocks() == pooledBlocks, "%llu jobs fell back to the block pool", static_cast<unsigned long long>(Internal::GetNumPooledJobBlocks() - pooledBlocks));
+
+        gate = ManagedJobHandle();
+        pinned.Complete();
+        JOB_TEST_CHECK(numPinnedExecuted.load() == 1, "pinned job executed %u times", numPinnedExecuted.load());
+    }
+
+}
+
+void* operator new(std::size_t numBytes) {
+    numHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* address = std::malloc(numBytes ? numBytes : 1)) {
+        return address;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* address) noexcept {
+    std::free(address);
+}
+
+void operator delete(void* address, std::size_t) noexcept {
+    std::free(address);
+}
+
+int main() {
+    JobSystem* jobSystem = Spark::Singleton<JobSystem>::GetInstance();
+
+    SteadyState(jobSystem);
+    OverlappingFrames(jobSystem);
+    PinnedBlock(jobSystem);
+
+    std::printf("frame arena: steady state, overlapping frames and pinned blocks passed\n");
+    return 0;
+}
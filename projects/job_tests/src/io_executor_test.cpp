@@ -0,0 +1,115 @@
+
+#include <job_tests.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Spark::Job;
+
+namespace {
+
+    constexpr std::size_t NUM_BLOCKS = 2000;
+    constexpr std::size_t BLOCK_SIZE = 4096;
+
+    // Writes every block of the file as its own operation (many more than the ring holds at once), then reads them
+    // back and checks their contents from jobs depending on the reads.
+    void WriteThenRead(JobSystem* jobSystem, int fileDescriptor) {
+        std::vector<unsigned char> data(NUM_BLOCKS * BLOCK_SIZE);
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<unsigned char>(i * 7 + i / BLOCK_SIZE);
+        }
+
+        std::vector<IoResult> writeResults(NUM_BLOCKS);
+        std::vector<ManagedJobHandle> writes;
+        writes.reserve(NUM_BLOCKS);
+
+        for (std::size_t i = 0; i < NUM_BLOCKS; ++i) {
+            writes.emplace_back(jobSystem->Write(fileDescriptor, data.data() + i * BLOCK_SIZE, BLOCK_SIZE, i * BLOCK_SIZE, &writeResults[i]));
+        }
+
+        for (std::size_t i = 0; i < NUM_BLOCKS; ++i) {
+            writes[i].Complete();
+            JOB_TEST_CHECK(writeResults[i].error == 0, "write of block %zu failed: %s", i, std::strerror(writeResults[i].error));
+            JOB_TEST_CHECK(writeResults[i].numBytes == BLOCK_SIZE, "write of block %zu wrote %zu bytes", i, writeResults[i].numBytes);
+        }
+
+        std::vector<unsigned char> readBack(data.size());
+        std::vector<IoResult> readResults(NUM_BLOCKS);
+        std::atomic<std::size_t> numMatching(0);
+        std::vector<ManagedJobHandle> checks;
+        checks.reserve(NUM_BLOCKS);
+
+        for (std::size_t i = 0; i < NUM_BLOCKS; ++i) {
+            ManagedJobHandle read = jobSystem->Read(fileDescriptor, readBack.data() + i * BLOCK_SIZE, BLOCK_SIZE, i * BLOCK_SIZE, &readResults[i]);
+            checks.emplace_back(jobSystem->Schedule([&, i]() {
+                if (readResults[i].numBytes == BLOCK_SIZE && std::memcmp(readBack.data() + i * BLOCK_SIZE, data.data() + i * BLOCK_SIZE, BLOCK_SIZE) == 0) {
+                    numMatching.fetch_add(1, std::memory_order_relaxed);
+                }
+            }));
+            checks.back().AddDependency(read);
+        }
+
+        for (ManagedJobHandle& check : checks) {
+            check.Complete();
+        }
+
+        JOB_TEST_CHECK(numMatching.load() == NUM_BLOCKS, "%zu of %zu blocks read back intact", numMatching.load(), NUM_BLOCKS);
+    }
+
+    // Reads past the end of the file are short, requests too large for one operation are clamped instead of
+    // truncated to their lower 32 bits.
+    void ShortReads(JobSystem* jobSystem, int fileDescriptor) {
+        std::vector<unsigned char> buffer(NUM_BLOCKS * BLOCK_SIZE);
+
+        IoResult tail;
+        jobSystem->Read(fileDescriptor, buffer.data(), 2 * BLOCK_SIZE, (NUM_BLOCKS - 1) * BLOCK_SIZE, &tail).Complete();
+        JOB_TEST_CHECK(tail.error == 0 && tail.numBytes == BLOCK_SIZE, "read at the last block returned %zu bytes (error %d)", tail.numBytes, tail.error);
+
+        IoResult end;
+        jobSystem->Read(fileDescriptor, buffer.data(), BLOCK_SIZE, NUM_BLOCKS * BLOCK_SIZE, &end).Complete();
+        JOB_TEST_CHECK(end.error == 0 && end.numBytes == 0, "read at the end returned %zu bytes (error %d)", end.numBytes, end.error);
+
+        // Only the size of the file is ever written to the buffer.
+        IoResult large;
+        jobSystem->Read(fileDescriptor, buffer.data(), (std::size_t(1) << 32) + 16, 0, &large).Complete();
+        JOB_TEST_CHECK(large.error == 0 && large.numBytes == buffer.size(), "read of 4 GiB returned %zu bytes (error %d)", large.numBytes, large.error);
+    }
+
+    void BadFileDescriptor(JobSystem* jobSystem) {
+        unsigned char buffer[16];
+
+        IoResult read;
+        jobSystem->Read(-1, buffer, sizeof(buffer), 0, &read).Complete();
+        JOB_TEST_CHECK(read.error == EBADF, "read of a bad file descriptor reported %d", read.error);
+        JOB_TEST_CHECK(read.numBytes == 0, "read of a bad file descriptor transferred %zu bytes", read.numBytes);
+
+        IoResult write;
+        jobSystem->Write(-1, buffer, sizeof(buffer), 0, &write).Complete();
+        JOB_TEST_CHECK(write.error == EBADF, "write to a bad file descriptor reported %d", write.error);
+    }
+
+}
+
+// Runs with io_uring (when the kernel allows it), or with the blocking fallback threads given --thread-pool.
+int main(int argc, char** argv) {
+    bool isThreadPool = argc > 1 && std::strcmp(argv[1], "--thread-pool") == 0;
+
+    WorkerPoolConfiguration configuration;
+    configuration.ioUring = !isThreadPool;
+    JobSystem::Configure(configuration);
+    JobSystem* jobSystem = Spark::Singleton<JobSystem>::GetInstance();
+
+    char path[] = "/tmp/spark_io_executor_test_XXXXXX";
+    int fileDescriptor = mkstemp(path);
+    JOB_TEST_CHECK(fileDescriptor >= 0, "could not create a temporary file: %s", std::strerror(errno));
+    unlink(path);
+
+    WriteThenRead(jobSystem, fileDescriptor);
+    ShortReads(jobSystem, fileDescriptor);
+    BadFileDescriptor(jobSystem);
+    close(fileDescriptor);
+
+    std::printf("io executor (%s): writes, reads, short reads and bad file descriptors passed\n", isThreadPool ? "threads" : "io_uring");
+    return 0;
+}
@@ -0,0 +1,137 @@
+
+#include <job_tests.h>
+#include <spark/job/worker/work_stealing_queue.h>
+
+using namespace Spark::Job;
+
+namespace {
+
+    // Jobs are never dereferenced by the queue, addresses into an array identify them.
+    struct Jobs {
+        explicit Jobs(std::size_t numJobs) : storage(numJobs),
+                                             numTaken(numJobs)
+                                             {
+        }
+
+        NODISCARD JobHandle* Get(std::size_t index) {
+            return reinterpret_cast<JobHandle*>(&storage[index]);
+        }
+
+        void Take(JobHandle* job) {
+            std::size_t index = static_cast<std::size_t>(reinterpret_cast<char*>(job) - storage.data());
+            JOB_TEST_CHECK(index < storage.size(), "job %p is not part of the test", static_cast<void*>(job));
+            numTaken[index].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(1, std::memory_order_release);
+        }
+
+        std::vector<char> storage;
+        std::vector<std::atomic<unsigned>> numTaken;
+        std::atomic<std::size_t> total { 0 };
+    };
+
+    // Owner order on a single thread: Pop is LIFO, Steal is FIFO, across growth of the buffer.
+    void SingleThreaded() {
+        constexpr std::size_t numJobs = 100;
+        Jobs jobs(numJobs);
+        WorkStealingQueue queue(2);
+
+        for (std::size_t i = 0; i < numJobs; ++i) {
+            queue.Push(jobs.Get(i));
+        }
+
+        JOB_TEST_CHECK(queue.GetSize() == numJobs, "size %zu", queue.GetSize());
+        JOB_TEST_CHECK(queue.Steal() == jobs.Get(0), "steal takes the oldest job");
+        JOB_TEST_CHECK(queue.Pop() == jobs.Get(numJobs - 1), "pop takes the newest job");
+
+        JobHandle* batch[3] = { jobs.Get(0), jobs.Get(numJobs - 1), jobs.Get(1) };
+        queue.Push(batch, 3);
+        JOB_TEST_CHECK(queue.Pop() == jobs.Get(1), "batch push keeps order");
+        JOB_TEST_CHECK(queue.GetSize() == numJobs, "size %zu", queue.GetSize());
+
+        while (queue.Pop()) {
+        }
+
+        JOB_TEST_CHECK(queue.IsEmpty(), "queue drained");
+        JOB_TEST_CHECK(queue.Steal() == nullptr, "steal from an empty queue");
+    }
+
+    // Owner pushes (one at a time and in batches) and pops against concurrent thieves, starting from a small capacity so
+    // the buffer grows while thieves are reading from it. Every job must be taken exactly once.
+    void OwnerAgainstThieves(unsigned numThieves, std::size_t numJobs) {
+        Jobs jobs(numJobs);
+        WorkStealingQueue queue(8);
+        std::atomic<bool> isStarted(false);
+
+        std::vector<std::thread> thieves;
+        for (unsigned i = 0; i < numThieves; ++i) {
+            thieves.emplace_back([&jobs, &queue, &isStarted, numJobs]() {
+                while (!isStarted.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+
+                while (jobs.total.load(std::memory_order_acquire) != numJobs) {
+                    if (JobHandle* job = queue.Steal()) {
+                        jobs.Take(job);
+                    }
+                }
+            });
+        }
+
+        isStarted.store(true, std::memory_order_release);
+
+        std::size_t next = 0;
+        JobHandle* batch[16];
+        while (next < numJobs) {
+            // Alternate single pushes, batches and pops, so the owner races thieves for the last element too.
+            std::size_t count = std::min<std::size_t>((next % 7 == 0) ? 16 : 1, numJobs - next);
+            if (count == 1) {
+                queue.Push(jobs.Get(next));
+            }
+            else {
+                for (std::size_t i = 0; i < count; ++i) {
+                    batch[i] = jobs.Get(next + i);
+                }
+
+                queue.Push(batch, count);
+            }
+
+            next += count;
+
+            if (next % 3 == 0) {
+                if (JobHandle* job = queue.Pop()) {
+                    jobs.Take(job);
+                }
+            }
+        }
+
+        while (JobHandle* job = queue.Pop()) {
+            jobs.Take(job);
+        }
+
+        for (std::thread& thief : thieves) {
+            thief.join();
+        }
+
+        JOB_TEST_CHECK(queue.IsEmpty(), "%zu jobs left", queue.GetSize());
+        for (std::size_t i = 0; i < numJobs; ++i) {
+            unsigned numTaken = jobs.numTaken[i].load(std::memory_order_relaxed);
+            JOB_TEST_CHECK(numTaken == 1, "job %zu taken %u times", i, numTaken);
+        }
+    }
+
+}
+
+int main(int argc, char** argv) {
+    // At least 3 thieves, more on machines with more hardware threads.
+    unsigned numThieves = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : std::max(3u, std::thread::hardware_concurrency() - 1);
+    unsigned numRounds = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 20;
+
+    SingleThreaded();
+
+    for (unsigned round = 0; round < numRounds; ++round) {
+        OwnerAgainstThieves(numThieves, 200000);
+    }
+
+    std::printf("work stealing queue: %u rounds with %u thieves passed\n", numRounds, numThieves);
+    return 0;
+}
@@ -57,7 +57,7 @@ void HandleTest3() {
     ManagedJobHandle handle1 = Spark::Singleton<JobSystem>::GetInstance()->Schedule<Test>(5);
     ManagedJobHandle handle2 = Spark::Singleton<JobSystem>::GetInstance()->Schedule<Test>(8);
 
-    handle2->AddDependency(handle1);
+    handle2.AddDependency(handle1);
 }
 
 // Single dependency, outside scope.
@@ -66,7 +66,7 @@ ManagedJobHandle HandleTest4() {
     ManagedJobHandle handle1 = Spark::Singleton<JobSystem>::GetInstance()->Schedule<Test>(5);
     ManagedJobHandle handle2 = Spark::Singleton<JobSystem>::GetInstance()->Schedule<Test>(8);
 
-    handle2->AddDependency(handle1);
+    handle2.AddDependency(handle1);
     return handle2;
 }
 
@@ -0,0 +1,25 @@
+
+#include "spark/job/cancellation_token.h"
+
+namespace Spark::Job {
+
+    CancellationToken::CancellationToken() : state_(std::make_shared<State>())
+                                             {
+    }
+
+    CancellationToken::~CancellationToken() {
+    }
+
+    void CancellationToken::Cancel() {
+        state_->isCancelled.store(true, std::memory_order_release);
+    }
+
+    bool CancellationToken::IsCancelled() const {
+        return state_->isCancelled.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t CancellationToken::GetNumSkippedJobs() const {
+        return state_->numSkippedJobs.load(std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,496 @@
+
+#include "spark/job/io_executor.h"
+#include "spark/job/job_handle.h"
+#include "spark/logger/logger.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+#ifdef SPARK_JOB_IO_URING
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+namespace Spark::Job {
+
+    #ifdef SPARK_JOB_IO_URING
+    namespace Internal {
+
+        // Minimal io_uring setup over the raw system calls: one submission queue written by a single thread at a time
+        // (callers synchronize), one completion queue read by a single thread.
+        class IoRing {
+            public:
+                // Returns nullptr if the kernel does not support (or does not allow) io_uring, or has no reads / writes
+                // for it.
+                static std::unique_ptr<IoRing> Create(unsigned numEntries) {
+                    io_uring_params parameters { };
+                    int fileDescriptor = static_cast<int>(syscall(__NR_io_uring_setup, numEntries, &parameters));
+                    if (fileDescriptor < 0) {
+                        return nullptr;
+                    }
+
+                    std::unique_ptr<IoRing> ring(new IoRing(fileDescriptor, parameters));
+                    if (!ring->Map() || !ring->ProbeOperations()) {
+                        return nullptr;
+                    }
+
+                    return ring;
+                }
+
+                ~IoRing() {
+                    if (submissionEntries_ != MAP_FAILED) {
+                        munmap(submissionEntries_, submissionEntriesSize_);
+                    }
+
+                    if (completionRing_ != MAP_FAILED && completionRing_ != submissionRing_) {
+                        munmap(completionRing_, completionRingSize_);
+                    }
+
+                    if (submissionRing_ != MAP_FAILED) {
+                        munmap(submissionRing_, submissionRingSize_);
+                    }
+
+                    close(fileDescriptor_);
+                }
+
+                // Operations the ring can hold.
+                NODISCARD unsigned GetNumEntries() const {
+                    return parameters_.sq_entries;
+                }
+
+                // Whether reads / writes go through IORING_OP_READV / IORING_OP_WRITEV (with a single buffer), as the
+                // kernel does not have IORING_OP_READ / IORING_OP_WRITE.
+                NODISCARD bool IsVectored() const {
+                    return isVectored_;
+                }
+
+                // Queues the operation and submits it to the kernel, the ring must have room for it. Returns 0, or the
+                // errno value if the kernel did not take the operation (it is then removed from the ring again).
+                int Push(std::uint8_t opcode, int fileDescriptor, void* address, std::uint32_t length, std::uint64_t offset, void* userData) {
+                    unsigned tail = LoadAcquire(submissionTail_);
+                    unsigned index = tail & *submissionMask_;
+
+                    io_uring_sqe& entry = static_cast<io_uring_sqe*>(submissionEntries_)[index];
+                    std::memset(&entry, 0, sizeof(io_uring_sqe));
+                    entry.opcode = opcode;
+                    entry.fd = fileDescriptor;
+                    entry.addr = reinterpret_cast<std::uint64_t>(address);
+                    entry.len = length;
+                    entry.off = offset;
+                    entry.user_data = reinterpret_cast<std::uint64_t>(userData);
+
+                    submissionArray_[index] = index;
+                    StoreRelease(submissionTail_, tail + 1);
+
+                    while (true) {
+                        long numSubmitted = syscall(__NR_io_uring_enter, fileDescriptor_, 1, 0, 0, nullptr, 0);
+                        if (numSubmitted == 1) {
+                            return 0;
+                        }
+
+                        if (numSubmitted < 0 && errno == EINTR) {
+                            continue;
+                        }
+
+                        // Out of memory (EAGAIN, ENOMEM) or completion queue overflow (EBUSY). The kernel only reads
+                        // the submission queue from io_uring_enter (no polling thread), the entry can be taken back.
+                        int error = numSubmitted < 0 ? errno : EAGAIN;
+                        StoreRelease(submissionTail_, tail);
+                        return error;
+                    }
+                }
+
+                // Blocks until at least one completion is available.
+                void Wait() {
+                    while (syscall(__NR_io_uring_enter, fileDescriptor_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno == EINTR) {
+                    }
+                }
+
+                // Calls function(userData, result) for every available completion. Returns the number of completions.
+                template <typename Function>
+                unsigned Reap(Function&& function) {
+                    unsigned head = *completionHead_;
+                    unsigned tail = LoadAcquire(completionTail_);
+                    unsigned numCompletions = tail - head;
+
+                    for (; head != tail; ++head) {
+                        const io_uring_cqe& completion = completionEntries_[head & *completionMask_];
+                        function(reinterpret_cast<void*>(completion.user_data), completion.res);
+                    }
+
+                    // Entries can be reused by the kernel once the head moves past them.
+                    StoreRelease(completionHead_, head);
+                    return numCompletions;
+                }
+
+            private:
+                IoRing(int fileDescriptor, const io_uring_params& parameters) : fileDescriptor_(fileDescriptor),
+                                                                                parameters_(parameters),
+                                                                                submissionRing_(MAP_FAILED),
+                                                                                submissionRingSize_(0),
+                                                                                completionRing_(MAP_FAILED),
+                                                                                completionRingSize_(0),
+                                                                                submissionEntries_(MAP_FAILED),
+                                                                                submissionEntriesSize_(0),
+                                                                                isVectored_(false)
+                                                                                {
+                }
+
+                bool Map() {
+                    submissionRingSize_ = parameters_.sq_off.array + parameters_.sq_entries * sizeof(std::uint32_t);
+                    completionRingSize_ = parameters_.cq_off.cqes + parameters_.cq_entries * sizeof(io_uring_cqe);
+
+                    // Both rings share one mapping on newer kernels.
+                    bool isSingleMapping = parameters_.features & IORING_FEAT_SINGLE_MMAP;
+                    if (isSingleMapping) {
+                        submissionRingSize_ = completionRingSize_ = std::max(submissionRingSize_, completionRingSize_);
+                    }
+
+                    submissionRing_ = mmap(nullptr, submissionRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileDescriptor_, IORING_OFF_SQ_RING);
+                    if (submissionRing_ == MAP_FAILED) {
+                        return false;
+                    }
+
+                    completionRing_ = isSingleMapping ? submissionRing_ : mmap(nullptr, completionRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileDescriptor_, IORING_OFF_CQ_RING);
+                    if (completionRing_ == MAP_FAILED) {
+                        return false;
+                    }
+
+                    submissionEntriesSize_ = parameters_.sq_entries * sizeof(io_uring_sqe);
+                    submissionEntries_ = mmap(nullptr, submissionEntriesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fileDescriptor_, IORING_OFF_SQES);
+                    if (submissionEntries_ == MAP_FAILED) {
+                        return false;
+                    }
+
+                    unsigned char* submission = static_cast<unsigned char*>(submissionRing_);
+                    submissionTail_ = reinterpret_cast<unsigned*>(submission + parameters_.sq_off.tail);
+                    submissionMask_ = reinterpret_cast<unsigned*>(submission + parameters_.sq_off.ring_mask);
+                    submissionArray_ = reinterpret_cast<unsigned*>(submission + parameters_.sq_off.array);
+
+                    unsigned char* completion = static_cast<unsigned char*>(completionRing_);
+                    completionHead_ = reinterpret_cast<unsigned*>(completion + parameters_.cq_off.head);
+                    completionTail_ = reinterpret_cast<unsigned*>(completion + parameters_.cq_off.tail);
+                    completionMask_ = reinterpret_cast<unsigned*>(completion + parameters_.cq_off.ring_mask);
+                    completionEntries_ = reinterpret_cast<io_uring_cqe*>(completion + parameters_.cq_off.cqes);
+                    return true;
+                }
+
+                // IORING_OP_READ / IORING_OP_WRITE came with Linux 5.6, earlier kernels fail them with EINVAL. The probe came
+                // with them, every kernel without it only has the vectored versions.
+                bool ProbeOperations() {
+                    std::vector<unsigned char> storage(sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op), 0);
+                    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+
+                    if (syscall(__NR_io_uring_register, fileDescriptor_, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0) {
+                        isVectored_ = true;
+                        return true;
+                    }
+
+                    auto isSupported = [probe](unsigned opcode) {
+                        return opcode < probe->ops_len && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+                    };
+
+                    if (isSupported(IORING_OP_READ) && isSupported(IORING_OP_WRITE)) {
+                        isVectored_ = false;
+                        return true;
+                    }
+
+                    isVectored_ = true;
+                    return isSupported(IORING_OP_READV) && isSupported(IORING_OP_WRITEV);
+                }
+
+                // Ring indices are shared with the kernel.
+                static unsigned LoadAcquire(const unsigned* address) {
+                    return __atomic_load_n(address, __ATOMIC_ACQUIRE);
+                }
+
+                static void StoreRelease(unsigned* address, unsigned value) {
+                    __atomic_store_n(address, value, __ATOMIC_RELEASE);
+                }
+
+                int fileDescriptor_;
+                io_uring_params parameters_;
+
+                void* submissionRing_;
+                std::size_t submissionRingSize_;
+                void* completionRing_;
+                std::size_t completionRingSize_;
+                void* submissionEntries_;
+                std::size_t submissionEntriesSize_;
+
+                unsigned* submissionTail_;
+                unsigned* submissionMask_;
+                unsigned* submissionArray_;
+
+                unsigned* completionHead_;
+                unsigned* completionTail_;
+                unsigned* completionMask_;
+                io_uring_cqe* completionEntries_;
+
+                bool isVectored_;
+        };
+
+    }
+    #endif
+
+    IoJob::IoJob(JobHandle* jobHandle, IoOperationType type, int fileDescriptor, void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result) : jobHandle_(jobHandle),
+                                                                                                                                                               type_(type),
+                                                                                                                                                               fileDescriptor_(fileDescriptor),
+                                                                                                                                                               buffer_(buffer),
+                                                                                                                                                               numBytes_(numBytes),
+                                                                                                                                                               offset_(offset),
+                                                                                                                                                               result_(result)
+                                                                                                                                                               {
+    }
+
+    IoJob::~IoJob() {
+    }
+
+    void IoJob::Execute() {
+        // Result was stored when the operation completed.
+    }
+
+    IoExecutor::IoExecutor(unsigned numThreads, bool useIoUring) : isShuttingDown_(false),
+                                                                   numInFlight_(0)
+                                                                   {
+        #ifdef SPARK_JOB_IO_URING
+            numRingOperations_ = 0;
+
+            if (useIoUring) {
+                ring_ = Internal::IoRing::Create(JOB_IO_QUEUE_DEPTH);
+            }
+
+            if (ring_) {
+                threads_.emplace_back(&IoExecutor::RunCompletionThread, this);
+                return;
+            }
+        #endif
+
+        for (unsigned i = 0; i < std::max(numThreads, 1u); ++i) {
+            threads_.emplace_back(&IoExecutor::RunThread, this);
+        }
+    }
+
+    IoExecutor::~IoExecutor() {
+        Shutdown();
+    }
+
+    void IoExecutor::Shutdown() {
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            if (isShuttingDown_) {
+                return;
+            }
+
+            isShuttingDown_ = true;
+
+            #ifdef SPARK_JOB_IO_URING
+                // No-op without a job stops the completion thread once everything submitted before it has completed.
+                if (ring_) {
+                    if (numRingOperations_ < ring_->GetNumEntries()) {
+                        ++numRingOperations_;
+
+                        // Only fails while the kernel is short on memory or completions, which the completion thread
+                        // clears up.
+                        while (ring_->Push(IORING_OP_NOP, -1, nullptr, 0, 0, nullptr) != 0) {
+                            std::this_thread::yield();
+                        }
+                    }
+                    else {
+                        pending_.emplace_back(nullptr);
+                    }
+                }
+            #endif
+        }
+
+        condition_.notify_all();
+
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+
+        threads_.clear();
+    }
+
+    void IoExecutor::Submit(IoJob* job) {
+        numInFlight_.fetch_add(1, std::memory_order_relaxed);
+
+        // Larger transfers are short, like a single read / write would be.
+        job->numBytes_ = std::min(job->numBytes_, MAX_TRANSFER);
+
+        #ifdef SPARK_JOB_IO_URING
+            int error = 0;
+        #endif
+
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            SP_ASSERT(!isShuttingDown_, "Calling Submit on IoExecutor that is shutting down.");
+
+            #ifdef SPARK_JOB_IO_URING
+                if (ring_) {
+                    if (numRingOperations_ < ring_->GetNumEntries()) {
+                        error = Push(job);
+                        if (!error) {
+                            ++numRingOperations_;
+                        }
+                    }
+                    else {
+                        // Moved into the ring by the completion thread.
+                        pending_.emplace_back(job);
+                    }
+                }
+                else {
+                    pending_.emplace_back(job);
+                }
+            #else
+                pending_.emplace_back(job);
+            #endif
+        }
+
+        #ifdef SPARK_JOB_IO_URING
+            if (ring_) {
+                if (error) {
+                    Complete(job, -static_cast<std::int64_t>(error));
+                }
+
+                return;
+            }
+        #endif
+
+        condition_.notify_one();
+    }
+
+    bool IoExecutor::IsUsingIoUring() const {
+        #ifdef SPARK_JOB_IO_URING
+            return ring_ != nullptr;
+        #else
+            return false;
+        #endif
+    }
+
+    std::size_t IoExecutor::GetNumInFlight() const {
+        return numInFlight_.load(std::memory_order_relaxed);
+    }
+
+    void IoExecutor::Complete(IoJob* job, std::int64_t result) {
+        if (result < 0) {
+            job->result_->numBytes = 0;
+            job->result_->error = static_cast<int>(-result);
+        }
+        else {
+            job->result_->numBytes = static_cast<std::size_t>(result);
+            job->result_->error = 0;
+        }
+
+        numInFlight_.fetch_sub(1, std::memory_order_relaxed);
+
+        // Job (and its handle) may be recycled past this point. Publishes the result to whoever completes the job.
+        job->jobHandle_->ReleaseDependency();
+    }
+
+    void IoExecutor::RunThread() {
+        while (true) {
+            IoJob* job;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]() {
+                    return isShuttingDown_ || !pending_.empty();
+                });
+
+                // Operations submitted before shutdown still complete.
+                if (pending_.empty()) {
+                    return;
+                }
+
+                job = pending_.front();
+                pending_.pop_front();
+            }
+
+            ssize_t result;
+            do {
+                if (job->type_ == IoOperationType::READ) {
+                    result = pread(job->fileDescriptor_, job->buffer_, job->numBytes_, static_cast<off_t>(job->offset_));
+                }
+                else {
+                    result = pwrite(job->fileDescriptor_, job->buffer_, job->numBytes_, static_cast<off_t>(job->offset_));
+                }
+            } while (result < 0 && errno == EINTR);
+
+            Complete(job, result < 0 ? -static_cast<std::int64_t>(errno) : static_cast<std::int64_t>(result));
+        }
+    }
+
+    #ifdef SPARK_JOB_IO_URING
+    int IoExecutor::Push(IoJob* job) {
+        bool isRead = job->type_ == IoOperationType::READ;
+        std::uint32_t numBytes = static_cast<std::uint32_t>(job->numBytes_);
+
+        if (ring_->IsVectored()) {
+            job->vector_.iov_base = job->buffer_;
+            job->vector_.iov_len = numBytes;
+            return ring_->Push(isRead ? IORING_OP_READV : IORING_OP_WRITEV, job->fileDescriptor_, &job->vector_, 1, job->offset_, job);
+        }
+
+        return ring_->Push(isRead ? IORING_OP_READ : IORING_OP_WRITE, job->fileDescriptor_, job->buffer_, numBytes, job->offset_, job);
+    }
+
+    void IoExecutor::RunCompletionThread() {
+        bool isStopping = false;
+
+        // Operations the kernel did not take, completed with their error outside of the lock.
+        std::vector<std::pair<IoJob*, int>> failed;
+
+        while (true) {
+            {
+                std::scoped_lock<std::mutex> lock(mutex_);
+                if (isStopping && numRingOperations_ == 0) {
+                    return;
+                }
+            }
+
+            ring_->Wait();
+
+            unsigned numCompletions = ring_->Reap([this, &isStopping](void* userData, std::int32_t result) {
+                if (!userData) {
+                    isStopping = true;
+                    return;
+                }
+
+                // Ordered after the submission by the kernel (invisible to thread sanitizers).
+                Complete(static_cast<IoJob*>(userData), result);
+            });
+
+            {
+                std::scoped_lock<std::mutex> lock(mutex_);
+                numRingOperations_ -= numCompletions;
+
+                // Fill the room that was freed up.
+                while (!pending_.empty() && numRingOperations_ < ring_->GetNumEntries()) {
+                    IoJob* job = pending_.front();
+                    pending_.pop_front();
+
+                    // Shutdown found the ring full, this thread is awake already and needs no no-op.
+                    if (!job) {
+                        isStopping = true;
+                    }
+                    else if (int error = Push(job)) {
+                        failed.emplace_back(job, error);
+                    }
+                    else {
+                        ++numRingOperations_;
+                    }
+                }
+            }
+
+            for (const std::pair<IoJob*, int>& operation : failed) {
+                Complete(operation.first, -static_cast<std::int64_t>(operation.second));
+            }
+
+            failed.clear();
+        }
+    }
+    #endif
+
+}
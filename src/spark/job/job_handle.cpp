@@ -1,91 +1,272 @@
 
 #include "spark/job/job_handle.h"
+#include "spark/job/job_system.h"
 #include "spark/logger/logger.h"
 
 namespace Spark::Job {
 
-    JobHandle::JobHandle() : dependencies_(),
-                             waitedOnComplete_(false),
-                             isComplete_(false),
-                             isReady_(false)
+    JobHandle::JobHandle() : status_(0),
+                             index_(0),
+                             nextFree_(0),
+                             dependencies_(),
+                             job_(),
+                             priority_(JobPriority::NORMAL),
+                             cancellation_(),
+                             deadline_(std::chrono::steady_clock::time_point::max()),
+                             numPendingDependencies_(1),
+                             dependents_(),
+                             dependentsClosed_(false),
+                             numUnfinishedJobs_(1),
+                             parent_(nullptr),
+                             numWaiters_(0),
+                             fiber_(nullptr)
                              {
     }
 
     JobHandle::~JobHandle() {
     }
 
-    void JobHandle::Complete() {
-        if (!isComplete_) {
-            // Begin execution on handle + dependencies.
-            Stage();
+    void JobHandle::Complete(std::uint32_t generation) {
+        // Begin execution on handle + dependencies.
+        Stage(generation);
 
-            while (!isComplete_) {
+        WorkerPool& workerPool = Singleton<JobSystem>::GetInstance()->GetWorkerPool();
+        Worker* worker = Worker::GetCurrentWorker();
+        unsigned numIdleIterations = 0;
+
+        while (!IsComplete(generation)) {
+            // Help out instead of blocking. On a worker thread, this is most likely a job this job depends on.
+            // Background jobs are never deferred here, this may well be waiting on one.
+            JobHandle* jobHandle = worker ? worker->GetJob(NUM_JOB_PRIORITIES) : workerPool.Steal();
+            if (jobHandle) {
+                Worker::ExecuteJob(jobHandle);
+                numIdleIterations = 0;
+
+                if (worker) {
+                    worker->CountExecutedJob(workerPool);
+                }
+
+                continue;
+            }
+
+            if (++numIdleIterations < WORKER_IDLE_SPIN_COUNT) {
                 std::this_thread::yield();
+                continue;
             }
 
-            waitedOnComplete_ = true;
-            isComplete_ = true;
-        }
-        else {
-            // Prevent additional Complete() calls on used JobHandle.
-            LogWarning("Calling Complete on used JobHandle, operation does not do anything.");
+            // Nothing to run, park until either a job gets submitted or a waited on job completes.
+            numIdleIterations = 0;
+            EventCount& idleEvent = workerPool.GetIdleEvent();
+
+            numWaiters_.fetch_add(1, std::memory_order_seq_cst);
+            std::uint64_t key = idleEvent.PrepareWait();
+            if (IsComplete(generation) || workerPool.HasQueuedJobs()) {
+                idleEvent.CancelWait();
+            }
+            else {
+                SP_JOB_TRACE(TraceEventType::PARK, 0);
+                std::chrono::steady_clock::time_point parkTime = std::chrono::steady_clock::now();
+                idleEvent.CommitWait(key);
+
+                if (worker) {
+                    worker->AddIdleTime(parkTime);
+                }
+
+                SP_JOB_TRACE(TraceEventType::WAKE, 0);
+            }
+            numWaiters_.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     void JobHandle::Signal() {
-        if (isComplete_) {
-            std::cout << "used" << std::endl;
+        {
+            std::scoped_lock<std::mutex> lock(dependentsMutex_);
+            SP_ASSERT(!dependentsClosed_, "Sanity check - Signal called on already used JobHandle.");
+            dependentsClosed_ = true;
         }
-//        SP_ASSERT(!isUsed_, "Sanity check - Signal called on already used JobHandle.");
-        isComplete_ = true;
-        isComplete_ = true;
-    }
 
-    void JobHandle::AddDependency(const ManagedJobHandle& managedJobHandle) {
-        if (!isComplete_) {
-            JobHandle* jobHandle = managedJobHandle.get();
-            dependencies_.emplace_back(jobHandle);
+        // No dependents can be added once closed. Dependent jobs that have no more pending dependencies get pushed
+        // onto the calling worker's queue.
+        for (JobHandle* dependent : dependents_) {
+            dependent->ReleaseDependency();
         }
-        else {
-            LogWarning("Calling AddDependency on used JobHandle, operation does not do anything.");
+
+        if (!dependents_.empty()) {
+            SP_JOB_TRACE(TraceEventType::RELEASE, static_cast<std::uint32_t>(dependents_.size()));
         }
+
+        dependents_.clear();
     }
 
-    const std::vector<JobHandle*>& JobHandle::GetDependencies() const {
-        return dependencies_;
+    void JobHandle::AddChild(JobHandle* child) {
+        // Parent cannot finish concurrently, as the job calling this is still running.
+        numUnfinishedJobs_.fetch_add(1, std::memory_order_relaxed);
+        child->parent_ = this;
     }
 
-    bool JobHandle::IsReady() const {
-        return isReady_;
+    bool JobHandle::Finish() {
+        // Publishes the work of every child to whichever thread ends up finishing the parent.
+        return numUnfinishedJobs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
     }
 
-    void JobHandle::Stage(const std::function<void(JobHandle*)>& callback) {
-        if (!isComplete_) {
-            // Mark all dependencies as ready for execution.
-            for (JobHandle* dependency : dependencies_) {
-                dependency->Stage(callback);
-            }
+    JobHandle* JobHandle::GetParent() const {
+        return parent_;
+    }
 
-            // Mark this as ready for execution.
-            isReady_ = true;
+    bool JobHandle::HasWaiters() const {
+        // Orders the generation bump in Reset before the load, pairs with the increment in Complete.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return numWaiters_.load(std::memory_order_relaxed) > 0;
+    }
+
+    void JobHandle::SetFiber(Fiber* fiber) {
+        fiber_ = fiber;
+    }
+
+    Fiber* JobHandle::GetFiber() const {
+        return fiber_;
+    }
+
+    void JobHandle::WaitOn(JobHandle* dependency, std::uint32_t dependencyGeneration) {
+        // Held until the fiber has switched out, the job must not be resubmitted while it is still running on it.
+        numPendingDependencies_.fetch_add(1, std::memory_order_relaxed);
+        AddDependency(dependency, dependencyGeneration);
+    }
+
+    void JobHandle::AddDependency(JobHandle* dependency, std::uint32_t dependencyGeneration) {
+        // Count the dependency before registering with it, as it may complete at any point after registration.
+        numPendingDependencies_.fetch_add(1, std::memory_order_relaxed);
+
+        if (dependency->AddDependent(this, dependencyGeneration)) {
+            dependencies_.emplace_back(dependency, dependencyGeneration);
         }
         else {
-            LogWarning("Calling Stage on used JobHandle, operation does not do anything.");
+            // Dependency has already completed. Job is not staged, so this can never reach zero.
+            numPendingDependencies_.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
-    void JobHandle::Reset() {
-        isComplete_ = false;
-        isReady_ = false;
+    void JobHandle::InheritCancellation(JobHandle* dependency, std::uint32_t dependencyGeneration) {
+        std::scoped_lock<std::mutex> lock(dependency->dependentsMutex_);
+        if (!dependency->dependentsClosed_ && dependency->GetGeneration() == dependencyGeneration) {
+            cancellation_ = dependency->cancellation_;
+        }
+    }
+
+    bool JobHandle::AddDependent(JobHandle* dependent, std::uint32_t generation) {
+        std::scoped_lock<std::mutex> lock(dependentsMutex_);
+        if (dependentsClosed_ || GetGeneration() != generation) {
+            return false;
+        }
+
+        dependents_.emplace_back(dependent);
+        return true;
+    }
+
+    void JobHandle::ReleaseDependency() {
+        if (numPendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // All dependencies are complete and the job is staged.
+            Singleton<JobSystem>::GetInstance()->GetWorkerPool().Submit(this);
+        }
+    }
 
-        // Clear dependency flags.
-        for (JobHandle* dependency : dependencies_) {
-            dependency->Reset();
+    bool JobHandle::IsStaged(std::uint32_t generation) const {
+        std::uint32_t status = status_.load(std::memory_order_acquire);
+        return (status >> 1u) != generation || (status & STAGED_BIT);
+    }
+
+    bool JobHandle::IsComplete(std::uint32_t generation) const {
+        return (status_.load(std::memory_order_acquire) >> 1u) != generation;
+    }
+
+    std::uint32_t JobHandle::GetGeneration() const {
+        return status_.load(std::memory_order_acquire) >> 1u;
+    }
+
+    void JobHandle::SetPriority(JobPriority priority) {
+        priority_ = priority;
+    }
+
+    JobPriority JobHandle::GetPriority() const {
+        return priority_;
+    }
+
+    void JobHandle::SetCancellationToken(const CancellationToken& token) {
+        cancellation_ = token.state_;
+    }
+
+    void JobHandle::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+        deadline_ = deadline;
+    }
+
+    bool JobHandle::HasDeadline() const {
+        return deadline_ != std::chrono::steady_clock::time_point::max();
+    }
+
+    std::chrono::steady_clock::time_point JobHandle::GetDeadline() const {
+        return deadline_;
+    }
+
+    bool JobHandle::Skip() {
+        // Jobs suspended on a fiber have already started.
+        if (!cancellation_ || fiber_ || !cancellation_->isCancelled.load(std::memory_order_acquire)) {
+            return false;
         }
 
+        cancellation_->numSkippedJobs.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    JobStorage& JobHandle::GetJob() {
+        return job_;
+    }
+
+    void JobHandle::Stage(std::uint32_t generation) {
+        // Only the first Stage call for the current generation continues.
+        std::uint32_t expected = generation << 1u;
+        if (!status_.compare_exchange_strong(expected, expected | STAGED_BIT, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return;
+        }
+
+        // Mark all dependencies as ready for execution.
+        for (const std::pair<JobHandle*, std::uint32_t>& dependency : dependencies_) {
+            dependency.first->Stage(dependency.second);
+        }
+
+        // Release the reference held while the job was not staged.
+        ReleaseDependency();
+    }
+
+    void JobHandle::Hold() {
+        numPendingDependencies_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void JobHandle::StageWithoutSubmit() {
+        status_.fetch_or(STAGED_BIT, std::memory_order_relaxed);
+        numPendingDependencies_.store(0, std::memory_order_relaxed);
+    }
+
+    void JobHandle::Reset() {
+        // Destroy the job object.
+        job_.Reset();
+        priority_ = JobPriority::NORMAL;
+        deadline_ = std::chrono::steady_clock::time_point::max();
+
         // Clear dependencies.
         dependencies_.clear();
-        waitedOnComplete_ = false;
+        numPendingDependencies_.store(1, std::memory_order_relaxed);
+
+        numUnfinishedJobs_.store(1, std::memory_order_relaxed);
+        parent_ = nullptr;
+        fiber_ = nullptr;
+
+        // Bumping the generation under the lock guarantees AddDependent never registers with a recycled handle.
+        std::scoped_lock<std::mutex> lock(dependentsMutex_);
+        dependentsClosed_ = false;
+        cancellation_.reset();
+
+        std::uint32_t generation = GetGeneration() + 1u;
+        status_.store((generation << 1u), std::memory_order_release);
     }
 
 }
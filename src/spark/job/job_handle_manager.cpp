@@ -1,36 +1,169 @@
 
 #include "spark/job/job_handle_manager.h"
-#include "spark/job/job_system.h"
 #include "spark/logger/logger.h"
 
 namespace Spark::Job {
 
-    JobHandleManager::JobHandleManager() {
+    JobHandleManager::JobHandleManager(std::size_t capacity) : chunkSize_(static_cast<std::uint32_t>(std::max<std::size_t>(capacity, 1))),
+                                                               freeList_(NULL_INDEX),
+                                                               numChunks_(0)
+                                                               {
+        for (std::atomic<JobHandle*>& chunk : chunks_) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+
+        AllocateChunk();
 	}
 
     JobHandleManager::~JobHandleManager() {
+        for (std::atomic<JobHandle*>& chunk : chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
     }
 
-    ManagedJobHandle JobHandleManager::GetAvailableJobHandle() {
-        JobHandle* rawHandle = new JobHandle();
-        validHandles_.emplace(rawHandle); // Register with manager.
-        ManagedJobHandle managedHandle (rawHandle, ::Spark::Internal::CallbackFromMemberFn(this, &JobHandleManager::ReturnJobHandle));
-        return managedHandle;
+    JobHandle* JobHandleManager::GetAvailableJobHandle() {
+        JobHandle* jobHandle = PopFreeList();
+
+        while (!jobHandle) {
+            // All handles are in use.
+            {
+                std::scoped_lock<std::mutex> lock(chunkMutex_);
+
+                // Another thread may have allocated a chunk while this thread waited for the lock.
+                jobHandle = PopFreeList();
+                if (!jobHandle) {
+                    AllocateChunk();
+                }
+            }
+
+            if (!jobHandle) {
+                jobHandle = PopFreeList();
+            }
+        }
+
+        return jobHandle;
+    }
+
+    void JobHandleManager::GetAvailableJobHandles(JobHandle** jobHandles, std::size_t count) {
+        std::size_t numHandles = PopFreeList(jobHandles, count);
+
+        while (numHandles < count) {
+            std::scoped_lock<std::mutex> lock(chunkMutex_);
+
+            numHandles += PopFreeList(jobHandles + numHandles, count - numHandles);
+            if (numHandles < count) {
+                AllocateChunk();
+                numHandles += PopFreeList(jobHandles + numHandles, count - numHandles);
+            }
+        }
     }
 
     void JobHandleManager::ReturnJobHandle(JobHandle* jobHandle) {
-        if (jobHandle->waitedOnComplete_) {
-            // Job has been completed.
-            auto jobHandleIter = validHandles_.find(jobHandle);
-            if (jobHandleIter != validHandles_.end()) {
-                validHandles_.erase(jobHandleIter);
+        jobHandle->Reset();
+        PushFreeList(jobHandle, jobHandle);
+    }
+
+    std::size_t JobHandleManager::GetCapacity() const {
+        return numChunks_.load(std::memory_order_acquire) * chunkSize_;
+    }
+
+    JobHandle* JobHandleManager::GetJobHandle(std::uint32_t index) const {
+        JobHandle* chunk = chunks_[index / chunkSize_].load(std::memory_order_acquire);
+        return &chunk[index % chunkSize_];
+    }
+
+    JobHandle* JobHandleManager::PopFreeList() {
+        std::uint64_t head = freeList_.load(std::memory_order_acquire);
+
+        while (true) {
+            std::uint32_t index = static_cast<std::uint32_t>(head);
+            if (index == NULL_INDEX) {
+                return nullptr;
             }
 
-            delete jobHandle;
+            // Handles are never deallocated, reading the next index of a handle that was concurrently popped is safe.
+            // The tag makes the CAS fail in that case.
+            JobHandle* jobHandle = GetJobHandle(index);
+            std::uint64_t tag = (head >> 32u) + 1u;
+            std::uint64_t next = (tag << 32u) | jobHandle->nextFree_.load(std::memory_order_relaxed);
+
+            if (freeList_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                return jobHandle;
+            }
         }
-        else {
-            jobHandle->Stage();
+    }
+
+    std::size_t JobHandleManager::PopFreeList(JobHandle** jobHandles, std::size_t count) {
+        std::uint64_t head = freeList_.load(std::memory_order_acquire);
+
+        while (true) {
+            // Walk the first 'count' handles of the list. The chain may change while it is being walked, in which case
+            // the tag makes the CAS fail. Indices read from a changing chain can refer to a chunk this thread has not
+            // seen published yet, those are not dereferenced.
+            std::uint32_t index = static_cast<std::uint32_t>(head);
+            std::size_t numChunks = numChunks_.load(std::memory_order_acquire);
+            std::size_t numHandles = 0;
+
+            while (numHandles < count && index != NULL_INDEX && index / chunkSize_ < numChunks) {
+                JobHandle* jobHandle = GetJobHandle(index);
+                jobHandles[numHandles++] = jobHandle;
+                index = jobHandle->nextFree_.load(std::memory_order_relaxed);
+            }
+
+            if (numHandles == 0 && static_cast<std::uint32_t>(head) == NULL_INDEX) {
+                return 0;
+            }
+
+            std::uint64_t tag = (head >> 32u) + 1u;
+            std::uint64_t next = (tag << 32u) | index;
+
+            if (numHandles == count || index == NULL_INDEX) {
+                if (freeList_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                    return numHandles;
+                }
+            }
+            else {
+                head = freeList_.load(std::memory_order_acquire);
+            }
         }
     }
 
+    void JobHandleManager::PushFreeList(JobHandle* first, JobHandle* last) {
+        std::uint64_t head = freeList_.load(std::memory_order_relaxed);
+
+        while (true) {
+            last->nextFree_.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+            std::uint64_t tag = (head >> 32u) + 1u;
+            std::uint64_t next = (tag << 32u) | first->index_;
+
+            if (freeList_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    void JobHandleManager::AllocateChunk() {
+        std::size_t chunkIndex = numChunks_.load(std::memory_order_relaxed);
+        SP_ASSERT(chunkIndex < MAX_CHUNKS, "Exceeded maximum number of JobHandles (%zu).", MAX_CHUNKS * chunkSize_);
+
+        if (chunkIndex > 0) {
+            LogWarning("All %zu JobHandles are in use, allocating %u more.", GetCapacity(), chunkSize_);
+        }
+
+        JobHandle* chunk = new JobHandle[chunkSize_];
+        std::uint32_t baseIndex = static_cast<std::uint32_t>(chunkIndex) * chunkSize_;
+
+        // Link handles in the new chunk together.
+        for (std::uint32_t i = 0; i < chunkSize_; ++i) {
+            chunk[i].index_ = baseIndex + i;
+            chunk[i].nextFree_.store(i + 1 < chunkSize_ ? baseIndex + i + 1 : NULL_INDEX, std::memory_order_relaxed);
+        }
+
+        // Publish the chunk before any of its handles can be reached through the free list.
+        chunks_[chunkIndex].store(chunk, std::memory_order_release);
+        numChunks_.store(chunkIndex + 1, std::memory_order_release);
+
+        PushFreeList(&chunk[0], &chunk[chunkSize_ - 1]);
+    }
+
 }
@@ -0,0 +1,265 @@
+
+#include "spark/job/job_storage.h"
+#include "spark/logger/logger.h"
+
+namespace Spark::Job {
+
+    namespace Internal {
+
+        // Blocks are grouped in power of 2 size classes, starting at twice the inline storage size. Jobs larger than
+        // the largest size class go straight to the global heap.
+        class JobBlockPool {
+            public:
+                static constexpr std::size_t NUM_SIZE_CLASSES = 6;
+                static constexpr std::size_t MIN_BLOCK_SIZE = JOB_INLINE_STORAGE_SIZE * 2;
+
+                ~JobBlockPool() {
+                    for (std::vector<void*>& freeBlocks : freeBlocks_) {
+                        for (void* block : freeBlocks) {
+                            ::operator delete(block);
+                        }
+                    }
+                }
+
+                void* Allocate(std::size_t numBytes) {
+                    std::size_t sizeClass = GetSizeClass(numBytes);
+                    if (sizeClass == NUM_SIZE_CLASSES) {
+                        return ::operator new(numBytes);
+                    }
+
+                    {
+                        std::scoped_lock<std::mutex> lock(mutex_);
+                        std::vector<void*>& freeBlocks = freeBlocks_[sizeClass];
+
+                        if (!freeBlocks.empty()) {
+                            void* block = freeBlocks.back();
+                            freeBlocks.pop_back();
+                            return block;
+                        }
+                    }
+
+                    return ::operator new(MIN_BLOCK_SIZE << sizeClass);
+                }
+
+                void Deallocate(void* address, std::size_t numBytes) {
+                    std::size_t sizeClass = GetSizeClass(numBytes);
+                    if (sizeClass == NUM_SIZE_CLASSES) {
+                        ::operator delete(address);
+                        return;
+                    }
+
+                    std::scoped_lock<std::mutex> lock(mutex_);
+                    freeBlocks_[sizeClass].emplace_back(address);
+                }
+
+            private:
+                static std::size_t GetSizeClass(std::size_t numBytes) {
+                    std::size_t sizeClass = 0;
+                    while (sizeClass < NUM_SIZE_CLASSES && (MIN_BLOCK_SIZE << sizeClass) < numBytes) {
+                        ++sizeClass;
+                    }
+
+                    return sizeClass;
+                }
+
+                std::mutex mutex_;
+                std::vector<void*> freeBlocks_[NUM_SIZE_CLASSES];
+        };
+
+        static JobBlockPool jobBlockPool;
+
+        // Frames started through BeginJobBlockFrame.
+        static std::atomic<std::uint32_t> jobBlockFrame(0);
+        static std::atomic<std::uint64_t> numPooledJobBlocks(0);
+
+        // Bump allocator owned by a single scheduling thread, split into segments that are reclaimed independently.
+        // Blocks are released from whichever thread destroys the job, a segment is rewound once every block allocated
+        // from it has been released. Deleted once the owning thread has exited and the last block has been released.
+        class FrameArena {
+            public:
+                static constexpr std::size_t SEGMENT_SIZE = JOB_FRAME_ARENA_SIZE / JOB_FRAME_ARENA_SEGMENTS;
+
+                FrameArena() : buffer_(static_cast<unsigned char*>(::operator new(JOB_FRAME_ARENA_SIZE))),
+                               segment_(0),
+                               offset_(0),
+                               frame_(jobBlockFrame.load(std::memory_order_relaxed)),
+                               numReferences_(1)
+                               {
+                    for (std::atomic<std::size_t>& numBlocks : numSegmentBlocks_) {
+                        numBlocks.store(0, std::memory_order_relaxed);
+                    }
+                }
+
+                ~FrameArena() {
+                    ::operator delete(buffer_);
+                }
+
+                // Owning thread only. Returns nullptr if no segment has room.
+                void* Allocate(std::size_t numBytes) {
+                    numBytes = (numBytes + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+                    if (numBytes > SEGMENT_SIZE) {
+                        return nullptr;
+                    }
+
+                    std::uint32_t frame = jobBlockFrame.load(std::memory_order_relaxed);
+                    if (frame != frame_) {
+                        // Jobs of the previous frame may still be running, leave their segment to them. Stays in the
+                        // current segment if every other segment is still in use.
+                        frame_ = frame;
+                        if (offset_ != 0) {
+                            static_cast<void>(NextSegment());
+                        }
+                    }
+
+                    if (offset_ != 0 && numSegmentBlocks_[segment_].load(std::memory_order_acquire) == 0) {
+                        // Every block of the segment has been released. Pairs with the decrement in Release so jobs have
+                        // been destroyed before their memory is reused.
+                        offset_ = 0;
+                    }
+
+                    if (numBytes > SEGMENT_SIZE - offset_ && !NextSegment()) {
+                        return nullptr;
+                    }
+
+                    void* block = buffer_ + segment_ * SEGMENT_SIZE + offset_;
+                    offset_ += numBytes;
+                    numSegmentBlocks_[segment_].fetch_add(1, std::memory_order_relaxed);
+                    numReferences_.fetch_add(1, std::memory_order_relaxed);
+                    return block;
+                }
+
+                // Called once per allocated block.
+                void Release(void* block) {
+                    std::size_t segment = static_cast<std::size_t>(static_cast<unsigned char*>(block) - buffer_) / SEGMENT_SIZE;
+                    numSegmentBlocks_[segment].fetch_sub(1, std::memory_order_release);
+                    Release();
+                }
+
+                // Called once by the owning thread when it exits.
+                void Release() {
+                    if (numReferences_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        delete this;
+                    }
+                }
+
+            private:
+                // Moves on to the next segment without blocks. Returns false if every other segment is in use.
+                bool NextSegment() {
+                    for (std::size_t i = 1; i < JOB_FRAME_ARENA_SEGMENTS; ++i) {
+                        std::size_t segment = (segment_ + i) % JOB_FRAME_ARENA_SEGMENTS;
+                        if (numSegmentBlocks_[segment].load(std::memory_order_acquire) == 0) {
+                            segment_ = segment;
+                            offset_ = 0;
+                            return true;
+                        }
+                    }
+
+                    return false;
+                }
+
+                unsigned char* buffer_;
+                std::size_t segment_;
+                std::size_t offset_;
+                std::uint32_t frame_;
+
+                std::atomic<std::size_t> numSegmentBlocks_[JOB_FRAME_ARENA_SEGMENTS];
+
+                // Allocated blocks + 1 for the owning thread.
+                std::atomic<std::size_t> numReferences_;
+        };
+
+        // Creates the arena of the calling thread on first use.
+        class ThreadFrameArena {
+            public:
+                ~ThreadFrameArena() {
+                    if (arena_) {
+                        arena_->Release();
+                    }
+                }
+
+                FrameArena* Get() {
+                    if (!arena_) {
+                        arena_ = new FrameArena();
+                    }
+
+                    return arena_;
+                }
+
+            private:
+                FrameArena* arena_ = nullptr;
+        };
+
+        static thread_local ThreadFrameArena threadFrameArena;
+
+        // Every block starts with the arena it was allocated from, nullptr for blocks from the block pool.
+        static constexpr std::size_t BLOCK_HEADER_SIZE = alignof(std::max_align_t);
+
+        void* AllocateJobBlock(std::size_t numBytes) {
+            std::size_t blockSize = numBytes + BLOCK_HEADER_SIZE;
+            FrameArena* arena = nullptr;
+            void* block = nullptr;
+
+            if constexpr (JOB_FRAME_ARENA_SIZE > 0) {
+                arena = threadFrameArena.Get();
+                block = arena->Allocate(blockSize);
+            }
+
+            if (!block) {
+                arena = nullptr;
+                block = jobBlockPool.Allocate(blockSize);
+                numPooledJobBlocks.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            *static_cast<FrameArena**>(block) = arena;
+            return static_cast<unsigned char*>(block) + BLOCK_HEADER_SIZE;
+        }
+
+        void DeallocateJobBlock(void* address, std::size_t numBytes) {
+            void* block = static_cast<unsigned char*>(address) - BLOCK_HEADER_SIZE;
+            FrameArena* arena = *static_cast<FrameArena**>(block);
+
+            if (arena) {
+                arena->Release(block);
+            }
+            else {
+                jobBlockPool.Deallocate(block, numBytes + BLOCK_HEADER_SIZE);
+            }
+        }
+
+        void BeginJobBlockFrame() {
+            jobBlockFrame.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::uint64_t GetNumPooledJobBlocks() {
+            return numPooledJobBlocks.load(std::memory_order_relaxed);
+        }
+
+    }
+
+    JobStorage::JobStorage() : job_(nullptr),
+                               trampoline_(nullptr)
+                               {
+    }
+
+    JobStorage::~JobStorage() {
+        Reset();
+    }
+
+    void JobStorage::Execute() {
+        SP_ASSERT(!IsEmpty(), "Calling Execute on empty JobStorage.");
+        trampoline_(Operation::EXECUTE, job_);
+    }
+
+    void JobStorage::Reset() {
+        if (!IsEmpty()) {
+            trampoline_(Operation::DESTROY, job_);
+            job_ = nullptr;
+            trampoline_ = nullptr;
+        }
+    }
+
+    bool JobStorage::IsEmpty() const {
+        return trampoline_ == nullptr;
+    }
+
+}
@@ -1,19 +1,176 @@
 
 #include "spark/job/job_system.h"
+#include "spark/logger/logger.h"
 
 namespace Spark::Job {
 
-    JobSystem::JobSystem() : workerPool_(4),
-                             jobHandleManager_(workerPool_.GetCapacity() * WORKER_JOB_CAPACITY)
+    WorkerPoolConfiguration JobSystem::configuration_ { };
+    std::atomic<bool> JobSystem::isConstructed_ { false };
+
+    JobSystem::JobSystem() : workerPool_(configuration_),
+                             jobHandleManager_(workerPool_.GetCapacity() * WORKER_JOB_CAPACITY),
+                             ioExecutor_(configuration_.numIoThreads, configuration_.ioUring)
                              {
+        isConstructed_.store(true);
+    }
+
+    void JobSystem::Configure(const WorkerPoolConfiguration& configuration) {
+        if (isConstructed_.load()) {
+            LogWarning("JobSystem::Configure called after the job system was constructed, configuration is ignored.");
+            return;
+        }
+
+        configuration_ = configuration;
     }
 
     JobSystem::~JobSystem() {
         std::cout << "shutting down job system" << std::endl;
+        ioExecutor_.Shutdown(); // Completed operations submit their jobs to the worker pool.
         workerPool_.Shutdown(); // Wait for all threads to finish before calling destructors.
     }
 
-    const WorkerPool& JobSystem::GetWorkerPool() const {
+    void JobSystem::ReturnJobHandle(JobHandle* jobHandle) {
+        jobHandleManager_.ReturnJobHandle(jobHandle);
+    }
+
+    ManagedJobHandle JobSystem::Read(int fileDescriptor, void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result) {
+        return SubmitIo(IoOperationType::READ, fileDescriptor, buffer, numBytes, offset, result);
+    }
+
+    ManagedJobHandle JobSystem::Write(int fileDescriptor, const void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result) {
+        return SubmitIo(IoOperationType::WRITE, fileDescriptor, const_cast<void*>(buffer), numBytes, offset, result);
+    }
+
+    ManagedJobHandle JobSystem::SubmitIo(IoOperationType type, int fileDescriptor, void* buffer, std::size_t numBytes, std::uint64_t offset, IoResult* result) {
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        IoJob& job = jobHandle->SetJob<IoJob>(jobHandle, type, fileDescriptor, buffer, numBytes, offset, result);
+
+        // Released by the I/O executor once the operation completes.
+        jobHandle->Hold();
+        ioExecutor_.Submit(&job);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    void JobSystem::BeginFrame(std::chrono::steady_clock::duration budget) {
+        Internal::BeginJobBlockFrame();
+        workerPool_.BeginFrame(budget);
+    }
+
+    FrameReport JobSystem::EndFrame() {
+        return workerPool_.EndFrame();
+    }
+
+    IdleStatistics JobSystem::GetIdleStatistics() const {
+        return workerPool_.GetIdleStatistics();
+    }
+
+    std::vector<WorkerStatistics> JobSystem::GetWorkerStatistics() const {
+        return workerPool_.GetWorkerStatistics();
+    }
+
+    WorkerStatistics JobSystem::GetStatistics() const {
+        return workerPool_.GetStatistics();
+    }
+
+    bool JobSystem::WriteTrace(const std::string& filename) const {
+        #ifdef SPARK_JOB_TRACING
+            std::ofstream file(filename);
+            if (!file) {
+                LogWarning("Failed to open trace file '%s', trace not written.", filename.c_str());
+                return false;
+            }
+
+            WriteChromeTrace(file, workerPool_.GetTraceEvents());
+            return static_cast<bool>(file);
+        #else
+            LogWarning("Calling WriteTrace without SPARK_JOB_TRACING enabled, operation does not do anything.");
+            return false;
+        #endif
+    }
+
+    void JobSystem::WaitFor(const ManagedJobHandle& handle) {
+        if (!handle.jobHandle_) {
+            LogWarning("Calling WaitFor on invalid JobHandle, operation does not do anything.");
+            return;
+        }
+
+        Worker::WaitFor(handle.jobHandle_, handle.generation_);
+    }
+
+    #ifdef SPARK_JOB_COROUTINES
+    ManagedJobHandle JobSystem::Schedule(Task<void> task) {
+        return Schedule(JobPriority::NORMAL, std::move(task));
+    }
+
+    ManagedJobHandle JobSystem::Schedule(JobPriority priority, Task<void> task) {
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<CoroutineJob>(jobHandle, std::move(task));
+        jobHandle->SetPriority(priority);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    void JobSystem::ScheduleContinuation(JobHandle* root, JobHandle* dependency, std::uint32_t dependencyGeneration, std::coroutine_handle<> coroutine) {
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<ResumeCoroutineJob>(coroutine);
+        jobHandle->SetPriority(root->GetPriority());
+        root->AddChild(jobHandle);
+
+        // Submitted to the worker completing the dependency.
+        jobHandle->AddDependency(dependency, dependencyGeneration);
+        jobHandle->Stage(jobHandle->GetGeneration());
+    }
+    #endif
+
+    ManagedJobHandle JobSystem::Run(TaskGraph& graph) {
+        return Run(JobPriority::NORMAL, graph);
+    }
+
+    ManagedJobHandle JobSystem::Run(JobPriority priority, TaskGraph& graph) {
+        if (graph.IsRunning()) {
+            LogWarning("Calling Run on a TaskGraph that is still running, operation does not do anything.");
+            return ManagedJobHandle();
+        }
+
+        if (!graph.IsCompiled() && !graph.Compile()) {
+            return ManagedJobHandle();
+        }
+
+        graph.isRunning_.store(true, std::memory_order_relaxed);
+
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<TaskGraphJob>(&graph, jobHandle, TaskGraphJob::ROOT);
+        jobHandle->SetPriority(priority);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    ManagedJobHandle JobSystem::Run(Pipeline& pipeline, unsigned numTokens) {
+        return Run(JobPriority::NORMAL, pipeline, numTokens);
+    }
+
+    ManagedJobHandle JobSystem::Run(JobPriority priority, Pipeline& pipeline, unsigned numTokens) {
+        if (pipeline.IsRunning()) {
+            LogWarning("Calling Run on a Pipeline that is still running, operation does not do anything.");
+            return ManagedJobHandle();
+        }
+
+        if (!pipeline.HasInput() || numTokens == 0) {
+            LogWarning("Calling Run on a Pipeline without input or tokens, operation does not do anything.");
+            return ManagedJobHandle();
+        }
+
+        pipeline.isRunning_.store(true, std::memory_order_relaxed);
+
+        JobHandle* jobHandle = jobHandleManager_.GetAvailableJobHandle();
+        jobHandle->SetJob<PipelineJob>(&pipeline, jobHandle, numTokens, 0, PipelineJob::ROOT);
+        jobHandle->SetPriority(priority);
+        return ManagedJobHandle(jobHandle, jobHandle->GetGeneration());
+    }
+
+    unsigned JobSystem::GetNumActiveWorkers() const {
+        return workerPool_.GetNumActiveWorkers();
+    }
+
+    WorkerPool& JobSystem::GetWorkerPool() {
         return workerPool_;
     }
 
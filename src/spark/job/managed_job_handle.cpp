@@ -0,0 +1,119 @@
+
+#include "spark/job/managed_job_handle.h"
+#include "spark/job/job_handle.h"
+#include "spark/job/job_system.h"
+#include "spark/logger/logger.h"
+
+namespace Spark::Job {
+
+    ManagedJobHandle::ManagedJobHandle() : jobHandle_(nullptr),
+                                           generation_(0),
+                                           priority_(JobPriority::NORMAL)
+                                           {
+    }
+
+    ManagedJobHandle::ManagedJobHandle(JobHandle* jobHandle, std::uint32_t generation) : jobHandle_(jobHandle),
+                                                                                          generation_(generation),
+                                                                                          priority_(jobHandle->GetPriority())
+                                                                                          {
+    }
+
+    ManagedJobHandle::~ManagedJobHandle() {
+        Release();
+    }
+
+    ManagedJobHandle::ManagedJobHandle(ManagedJobHandle&& other) noexcept : jobHandle_(other.jobHandle_),
+                                                                            generation_(other.generation_),
+                                                                            priority_(other.priority_)
+                                                                            {
+        other.jobHandle_ = nullptr;
+    }
+
+    ManagedJobHandle& ManagedJobHandle::operator=(ManagedJobHandle&& other) noexcept {
+        if (this != &other) {
+            Release();
+            jobHandle_ = other.jobHandle_;
+            generation_ = other.generation_;
+            priority_ = other.priority_;
+            other.jobHandle_ = nullptr;
+        }
+
+        return *this;
+    }
+
+    void ManagedJobHandle::AddDependency(const ManagedJobHandle& dependency) {
+        if (!jobHandle_ || jobHandle_->IsStaged(generation_)) {
+            LogWarning("Calling AddDependency on staged JobHandle, operation does not do anything.");
+            return;
+        }
+
+        if (!dependency.jobHandle_) {
+            LogWarning("Calling AddDependency with an invalid JobHandle, operation does not do anything.");
+            return;
+        }
+
+        jobHandle_->AddDependency(dependency.jobHandle_, dependency.generation_);
+    }
+
+    void ManagedJobHandle::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+        if (!jobHandle_ || jobHandle_->IsStaged(generation_)) {
+            LogWarning("Calling SetDeadline on staged JobHandle, operation does not do anything.");
+            return;
+        }
+
+        jobHandle_->SetDeadline(deadline);
+    }
+
+    void ManagedJobHandle::SetFrameDeadline() {
+        std::chrono::steady_clock::time_point frameEnd = Singleton<JobSystem>::GetInstance()->GetWorkerPool().GetFrameEnd();
+        if (frameEnd == std::chrono::steady_clock::time_point::max()) {
+            LogWarning("Calling SetFrameDeadline outside of a frame, operation does not do anything.");
+            return;
+        }
+
+        SetDeadline(frameEnd);
+    }
+
+    bool ManagedJobHandle::CanContinue() const {
+        if (!jobHandle_) {
+            LogWarning("Calling Then on invalid JobHandle, operation does not do anything.");
+            return false;
+        }
+
+        return true;
+    }
+
+    JobPriority ManagedJobHandle::GetPriority() const {
+        return priority_;
+    }
+
+    void ManagedJobHandle::AddContinuation(const ManagedJobHandle& continuation) const {
+        continuation.jobHandle_->InheritCancellation(jobHandle_, generation_);
+        continuation.jobHandle_->AddDependency(jobHandle_, generation_);
+    }
+
+    void ManagedJobHandle::Complete() {
+        if (!jobHandle_) {
+            LogWarning("Calling Complete on invalid JobHandle, operation does not do anything.");
+            return;
+        }
+
+        jobHandle_->Complete(generation_);
+    }
+
+    bool ManagedJobHandle::IsComplete() const {
+        return !jobHandle_ || jobHandle_->IsComplete(generation_);
+    }
+
+    bool ManagedJobHandle::IsValid() const {
+        return jobHandle_ != nullptr;
+    }
+
+    void ManagedJobHandle::Release() {
+        if (jobHandle_) {
+            jobHandle_->Stage(generation_);
+            jobHandle_ = nullptr;
+        }
+    }
+
+}
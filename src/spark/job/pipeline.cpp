@@ -0,0 +1,248 @@
+
+#include "spark/job/pipeline.h"
+#include "spark/job/job_system.h"
+#include "spark/logger/logger.h"
+
+namespace Spark::Job {
+
+    namespace Internal {
+
+        constexpr std::uint64_t EMPTY_SEQUENCE = std::numeric_limits<std::uint64_t>::max();
+
+    }
+
+    Pipeline::Stage::Stage(PipelineStageMode mode, std::function<void(unsigned)> function) : mode(mode),
+                                                                                           function(std::move(function)),
+                                                                                           isBusy(false),
+                                                                                           nextSequence(0)
+                                                                                           {
+    }
+
+    Pipeline::Pipeline() : numTokens_(0),
+                           isInputBusy_(false),
+                           isInputEnded_(false),
+                           nextSequence_(0),
+                           isRunning_(false)
+                           {
+    }
+
+    Pipeline::~Pipeline() {
+        SP_ASSERT(!IsRunning(), "Pipeline destroyed while running.");
+    }
+
+    void Pipeline::SetInput(std::function<bool(unsigned)> input) {
+        SP_ASSERT(!IsRunning(), "Pipeline modified while running.");
+        input_ = std::move(input);
+    }
+
+    void Pipeline::AddStage(PipelineStageMode mode, std::function<void(unsigned)> stage) {
+        SP_ASSERT(!IsRunning(), "Pipeline modified while running.");
+        stages_.emplace_back(std::make_unique<Stage>(mode, std::move(stage)));
+    }
+
+    bool Pipeline::HasInput() const {
+        return static_cast<bool>(input_);
+    }
+
+    bool Pipeline::IsRunning() const {
+        return isRunning_.load(std::memory_order_acquire);
+    }
+
+    unsigned Pipeline::GetNumStages() const {
+        return static_cast<unsigned>(stages_.size());
+    }
+
+    void Pipeline::Start(JobHandle* root, unsigned numTokens) {
+        // Published to other workers by submitting the first children.
+        numTokens_ = numTokens;
+        isInputBusy_ = true;
+        isInputEnded_ = false;
+        nextSequence_ = 0;
+
+        // Token 0 runs the input first.
+        freeTokens_.clear();
+        for (unsigned token = numTokens; token > 1; --token) {
+            freeTokens_.emplace_back(token - 1);
+        }
+
+        for (std::unique_ptr<Stage>& stage : stages_) {
+            stage->isBusy = false;
+            stage->nextSequence = 0;
+
+            if (stage->mode == PipelineStageMode::SERIAL_IN_ORDER) {
+                stage->waiting.assign(numTokens, { 0, Internal::EMPTY_SEQUENCE });
+            }
+            else {
+                stage->waiting.clear();
+                stage->waiting.reserve(numTokens);
+            }
+        }
+
+        Execute(0, 0, PipelineJob::INPUT, root);
+    }
+
+    void Pipeline::Execute(unsigned token, std::uint64_t sequence, unsigned stage, JobHandle* root) {
+        while (true) {
+            if (stage == PipelineJob::INPUT) {
+                if (!input_(token)) {
+                    EndInput(token);
+                    return;
+                }
+
+                sequence = nextSequence_++;
+                ReleaseInput(root);
+            }
+            else {
+                Stage& current = *stages_[stage];
+                current.function(token);
+
+                if (current.mode != PipelineStageMode::PARALLEL) {
+                    ReleaseStage(current, stage, root);
+                }
+            }
+
+            // Parallel stages continue on this worker without going through a queue, the token goes back to the input
+            // once it has passed every stage.
+            stage = (stage == PipelineJob::INPUT) ? 0 : stage + 1;
+            if (stage == stages_.size()) {
+                if (!AcquireInput(token)) {
+                    return;
+                }
+
+                stage = PipelineJob::INPUT;
+            }
+            else if (stages_[stage]->mode != PipelineStageMode::PARALLEL && !AcquireStage(*stages_[stage], token, sequence)) {
+                return;
+            }
+        }
+    }
+
+    bool Pipeline::AcquireInput(unsigned token) {
+        bool isFinished = false;
+
+        {
+            std::lock_guard lock(inputMutex_);
+            if (!isInputBusy_ && !isInputEnded_) {
+                isInputBusy_ = true;
+                return true;
+            }
+
+            freeTokens_.emplace_back(token);
+            isFinished = isInputEnded_ && freeTokens_.size() == numTokens_;
+        }
+
+        // Last token of the run, the pipeline is no longer touched and can be run again.
+        if (isFinished) {
+            isRunning_.store(false, std::memory_order_release);
+        }
+
+        return false;
+    }
+
+    bool Pipeline::AcquireStage(Stage& stage, unsigned token, std::uint64_t sequence) {
+        std::lock_guard lock(stage.mutex);
+
+        if (stage.mode == PipelineStageMode::SERIAL_IN_ORDER) {
+            if (!stage.isBusy && sequence == stage.nextSequence) {
+                stage.isBusy = true;
+                return true;
+            }
+
+            stage.waiting[sequence % numTokens_] = { token, sequence };
+            return false;
+        }
+
+        if (!stage.isBusy) {
+            stage.isBusy = true;
+            return true;
+        }
+
+        stage.waiting.push_back({ token, sequence });
+        return false;
+    }
+
+    void Pipeline::ReleaseInput(JobHandle* root) {
+        unsigned next;
+
+        {
+            std::lock_guard lock(inputMutex_);
+            if (freeTokens_.empty()) {
+                isInputBusy_ = false;
+                return;
+            }
+
+            next = freeTokens_.back();
+            freeTokens_.pop_back();
+        }
+
+        Singleton<JobSystem>::GetInstance()->ScheduleChild<PipelineJob>(root, this, root, next, 0, PipelineJob::INPUT);
+    }
+
+    void Pipeline::ReleaseStage(Stage& stage, unsigned index, JobHandle* root) {
+        WaitingToken next { };
+
+        {
+            std::lock_guard lock(stage.mutex);
+
+            if (stage.mode == PipelineStageMode::SERIAL_IN_ORDER) {
+                ++stage.nextSequence;
+
+                WaitingToken& waiting = stage.waiting[stage.nextSequence % numTokens_];
+                if (waiting.sequence != stage.nextSequence) {
+                    stage.isBusy = false;
+                    return;
+                }
+
+                next = waiting;
+                waiting.sequence = Internal::EMPTY_SEQUENCE;
+            }
+            else {
+                if (stage.waiting.empty()) {
+                    stage.isBusy = false;
+                    return;
+                }
+
+                next = stage.waiting.back();
+                stage.waiting.pop_back();
+            }
+        }
+
+        // Stage stays busy, the next token already holds it.
+        Singleton<JobSystem>::GetInstance()->ScheduleChild<PipelineJob>(root, this, root, next.token, next.sequence, index);
+    }
+
+    void Pipeline::EndInput(unsigned token) {
+        bool isFinished = false;
+
+        {
+            std::lock_guard lock(inputMutex_);
+            isInputBusy_ = false;
+            isInputEnded_ = true;
+
+            freeTokens_.emplace_back(token);
+            isFinished = freeTokens_.size() == numTokens_;
+        }
+
+        if (isFinished) {
+            isRunning_.store(false, std::memory_order_release);
+        }
+    }
+
+    PipelineJob::PipelineJob(Pipeline* pipeline, JobHandle* root, unsigned token, std::uint64_t sequence, unsigned stage) : pipeline_(pipeline),
+                                                                                                                           root_(root),
+                                                                                                                           token_(token),
+                                                                                                                           sequence_(sequence),
+                                                                                                                           stage_(stage)
+                                                                                                                           {
+    }
+
+    void PipelineJob::Execute() {
+        if (stage_ == ROOT) {
+            pipeline_->Start(root_, token_);
+        }
+        else {
+            pipeline_->Execute(token_, sequence_, stage_, root_);
+        }
+    }
+
+}
@@ -0,0 +1,175 @@
+
+#include "spark/job/task_graph.h"
+#include "spark/job/job_system.h"
+#include "spark/logger/logger.h"
+
+namespace Spark::Job {
+
+    TaskGraph::TaskGraph() : isCompiled_(false),
+                             numUnfinishedTasks_(0),
+                             isRunning_(false)
+                             {
+    }
+
+    TaskGraph::~TaskGraph() {
+        SP_ASSERT(!IsRunning(), "TaskGraph destroyed while running.");
+    }
+
+    unsigned TaskGraph::AddTask(std::function<void()> task) {
+        SP_ASSERT(!IsRunning(), "TaskGraph modified while running.");
+
+        tasks_.emplace_back(std::move(task));
+        isCompiled_ = false;
+        return static_cast<unsigned>(tasks_.size() - 1);
+    }
+
+    void TaskGraph::AddEdge(unsigned before, unsigned after) {
+        SP_ASSERT(!IsRunning(), "TaskGraph modified while running.");
+
+        if (before >= tasks_.size() || after >= tasks_.size()) {
+            LogWarning("Calling AddEdge with an invalid task (%u -> %u, graph has %zu tasks), operation does not do anything.", before, after, tasks_.size());
+            return;
+        }
+
+        edges_.emplace_back(before, after);
+        isCompiled_ = false;
+    }
+
+    bool TaskGraph::Compile() {
+        SP_ASSERT(!IsRunning(), "TaskGraph compiled while running.");
+
+        unsigned numTasks = GetNumTasks();
+        indegrees_.assign(numTasks, 0);
+        successorOffsets_.assign(numTasks + 1, 0);
+        successors_.resize(edges_.size());
+        roots_.clear();
+
+        // Counting sort of the edges by source task.
+        for (const std::pair<unsigned, unsigned>& edge : edges_) {
+            ++successorOffsets_[edge.first + 1];
+            ++indegrees_[edge.second];
+        }
+
+        for (unsigned task = 0; task < numTasks; ++task) {
+            successorOffsets_[task + 1] += successorOffsets_[task];
+        }
+
+        std::vector<unsigned> insert(successorOffsets_.begin(), successorOffsets_.end() - 1);
+        for (const std::pair<unsigned, unsigned>& edge : edges_) {
+            successors_[insert[edge.first]++] = edge.second;
+        }
+
+        for (unsigned task = 0; task < numTasks; ++task) {
+            if (indegrees_[task] == 0) {
+                roots_.emplace_back(task);
+            }
+        }
+
+        // Every task must be reachable through a topological order, anything left over is part of a cycle.
+        std::vector<unsigned> indegrees = indegrees_;
+        std::vector<unsigned> ready = roots_;
+        unsigned numVisited = 0;
+
+        while (!ready.empty()) {
+            unsigned task = ready.back();
+            ready.pop_back();
+            ++numVisited;
+
+            for (unsigned i = successorOffsets_[task]; i < successorOffsets_[task + 1]; ++i) {
+                if (--indegrees[successors_[i]] == 0) {
+                    ready.emplace_back(successors_[i]);
+                }
+            }
+        }
+
+        if (numVisited != numTasks) {
+            LogWarning("TaskGraph contains a cycle (%u of %u tasks reachable), graph cannot be run.", numVisited, numTasks);
+            isCompiled_ = false;
+            return false;
+        }
+
+        numPendingPredecessors_ = std::make_unique<std::atomic<unsigned>[]>(numTasks);
+        isCompiled_ = true;
+        return true;
+    }
+
+    bool TaskGraph::IsCompiled() const {
+        return isCompiled_;
+    }
+
+    bool TaskGraph::IsRunning() const {
+        return isRunning_.load(std::memory_order_acquire);
+    }
+
+    unsigned TaskGraph::GetNumTasks() const {
+        return static_cast<unsigned>(tasks_.size());
+    }
+
+    void TaskGraph::Start(JobHandle* root) {
+        unsigned numTasks = GetNumTasks();
+        if (numTasks == 0) {
+            isRunning_.store(false, std::memory_order_release);
+            return;
+        }
+
+        // Published to other workers by submitting the first children.
+        numUnfinishedTasks_.store(numTasks, std::memory_order_relaxed);
+        for (unsigned task = 0; task < numTasks; ++task) {
+            numPendingPredecessors_[task].store(indegrees_[task], std::memory_order_relaxed);
+        }
+
+        JobSystem* jobSystem = Singleton<JobSystem>::GetInstance();
+        for (std::size_t i = 1; i < roots_.size(); ++i) {
+            jobSystem->ScheduleChild<TaskGraphJob>(root, this, root, roots_[i]);
+        }
+
+        Execute(roots_[0], root);
+    }
+
+    void TaskGraph::Execute(unsigned task, JobHandle* root) {
+        JobSystem* jobSystem = Singleton<JobSystem>::GetInstance();
+
+        while (task != TaskGraphJob::ROOT) {
+            tasks_[task]();
+
+            // The first successor released continues on this worker without going through a queue.
+            unsigned next = TaskGraphJob::ROOT;
+            for (unsigned i = successorOffsets_[task]; i < successorOffsets_[task + 1]; ++i) {
+                unsigned successor = successors_[i];
+                if (numPendingPredecessors_[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                    continue;
+                }
+
+                if (next == TaskGraphJob::ROOT) {
+                    next = successor;
+                }
+                else {
+                    jobSystem->ScheduleChild<TaskGraphJob>(root, this, root, successor);
+                }
+            }
+
+            // Counters are no longer touched once the last task finishes, the graph can be run again.
+            if (numUnfinishedTasks_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                isRunning_.store(false, std::memory_order_release);
+            }
+
+            task = next;
+        }
+    }
+
+    TaskGraphJob::TaskGraphJob(TaskGraph* graph, JobHandle* root, unsigned task) : graph_(graph),
+                                                                                   root_(root),
+                                                                                   task_(task)
+                                                                                   {
+    }
+
+    void TaskGraphJob::Execute() {
+        if (task_ == ROOT) {
+            graph_->Start(root_);
+        }
+        else {
+            graph_->Execute(task_, root_);
+        }
+    }
+
+}
@@ -0,0 +1,15 @@
+
+#include "spark/job/types/batch_job.h"
+#include "spark/job/job_system.h"
+
+namespace Spark::Job {
+
+    BatchJob::BatchJob(std::vector<JobHandle*> jobs) : jobs_(std::move(jobs))
+                                                      {
+    }
+
+    void BatchJob::Execute() {
+        Singleton<JobSystem>::GetInstance()->GetWorkerPool().SubmitBatch(jobs_.data(), jobs_.size());
+    }
+
+}
@@ -0,0 +1,118 @@
+
+#ifdef SPARK_JOB_COROUTINES
+
+#include "spark/job/types/task.h"
+#include "spark/job/job_system.h"
+#include "spark/logger/logger.h"
+
+namespace Spark::Job {
+
+    TaskFinalAwaiter::TaskFinalAwaiter(std::coroutine_handle<> continuation) : continuation_(continuation) {
+    }
+
+    bool TaskFinalAwaiter::await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> TaskFinalAwaiter::await_suspend(std::coroutine_handle<> coroutine) const noexcept {
+        // Outermost task stays suspended until its root job destroys it.
+        if (continuation_) {
+            return continuation_;
+        }
+
+        return std::noop_coroutine();
+    }
+
+    void TaskFinalAwaiter::await_resume() const noexcept {
+    }
+
+    void* TaskPromiseBase::operator new(std::size_t numBytes) {
+        return Internal::AllocateJobBlock(numBytes);
+    }
+
+    void TaskPromiseBase::operator delete(void* address, std::size_t numBytes) {
+        Internal::DeallocateJobBlock(address, numBytes);
+    }
+
+    std::suspend_always TaskPromiseBase::initial_suspend() const noexcept {
+        return { };
+    }
+
+    TaskFinalAwaiter TaskPromiseBase::final_suspend() const noexcept {
+        return TaskFinalAwaiter(continuation_);
+    }
+
+    void TaskPromiseBase::unhandled_exception() const {
+        LogError("Unhandled exception in Task.");
+        std::terminate();
+    }
+
+    void TaskPromiseBase::SetRoot(JobHandle* root) {
+        root_ = root;
+    }
+
+    JobHandle* TaskPromiseBase::GetRoot() const {
+        return root_;
+    }
+
+    void TaskPromiseBase::SetContinuation(std::coroutine_handle<> continuation) {
+        continuation_ = continuation;
+    }
+
+    Task<void> TaskPromise<void>::get_return_object() {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    void TaskPromise<void>::return_void() const {
+    }
+
+    void TaskPromise<void>::GetResult() const {
+    }
+
+    JobAwaiter::JobAwaiter(const ManagedJobHandle& handle) : jobHandle_(handle.jobHandle_),
+                                                             generation_(handle.generation_)
+                                                             {
+    }
+
+    bool JobAwaiter::await_ready() const {
+        if (!jobHandle_) {
+            LogWarning("Calling co_await on invalid JobHandle, operation does not do anything.");
+            return true;
+        }
+
+        jobHandle_->Stage(generation_);
+        return jobHandle_->IsComplete(generation_);
+    }
+
+    void JobAwaiter::await_resume() const noexcept {
+    }
+
+    void JobAwaiter::Suspend(JobHandle* root, std::coroutine_handle<> coroutine) const {
+        // Task may be resumed (and this awaiter destroyed) on another worker as soon as this returns.
+        Singleton<JobSystem>::GetInstance()->ScheduleContinuation(root, jobHandle_, generation_, coroutine);
+    }
+
+    JobAwaiter operator co_await(const ManagedJobHandle& handle) {
+        return JobAwaiter(handle);
+    }
+
+    CoroutineJob::CoroutineJob(JobHandle* root, Task<void> task) : root_(root),
+                                                                   task_(std::move(task))
+                                                                   {
+    }
+
+    void CoroutineJob::Execute() {
+        task_.coroutine_.promise().SetRoot(root_);
+        task_.coroutine_.resume();
+    }
+
+    ResumeCoroutineJob::ResumeCoroutineJob(std::coroutine_handle<> coroutine) : coroutine_(coroutine) {
+    }
+
+    void ResumeCoroutineJob::Execute() {
+        coroutine_.resume();
+    }
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+
+#include "spark/job/worker/cpu_topology.h"
+#include <sched.h>
+
+namespace Spark::Job {
+
+    namespace Internal {
+
+        const std::string CPU_DIRECTORY = "/sys/devices/system/cpu/";
+
+        bool ReadValue(const std::string& path, std::string& value) {
+            std::ifstream file(path);
+            return static_cast<bool>(std::getline(file, value));
+        }
+
+        bool ReadValue(const std::string& path, unsigned& value) {
+            std::ifstream file(path);
+            return static_cast<bool>(file >> value);
+        }
+
+        // Parses the kernel CPU list format, for example "0-3,8,10-11".
+        std::vector<unsigned> ParseProcessorList(const std::string& list) {
+            std::vector<unsigned> processors;
+            std::stringstream stream(list);
+            std::string range;
+
+            while (std::getline(stream, range, ',')) {
+                if (range.empty()) {
+                    continue;
+                }
+
+                std::size_t separator = range.find('-');
+                unsigned first = std::stoul(range.substr(0, separator));
+                unsigned last = separator == std::string::npos ? first : std::stoul(range.substr(separator + 1));
+
+                for (unsigned processor = first; processor <= last; ++processor) {
+                    processors.emplace_back(processor);
+                }
+            }
+
+            return processors;
+        }
+
+        // Lowest numbered processor sharing the last level (highest level data / unified) cache with the given one.
+        unsigned GetLastLevelCacheOwner(unsigned processor) {
+            std::string cacheDirectory = CPU_DIRECTORY + "cpu" + std::to_string(processor) + "/cache/";
+            unsigned highestLevel = 0;
+            unsigned owner = processor;
+
+            for (unsigned index = 0; ; ++index) {
+                std::string indexDirectory = cacheDirectory + "index" + std::to_string(index) + "/";
+                unsigned level;
+                std::string type;
+                std::string sharedProcessors;
+
+                if (!ReadValue(indexDirectory + "level", level)) {
+                    break;
+                }
+
+                if (!ReadValue(indexDirectory + "type", type) || type == "Instruction" || level <= highestLevel) {
+                    continue;
+                }
+
+                if (ReadValue(indexDirectory + "shared_cpu_list", sharedProcessors)) {
+                    std::vector<unsigned> shared = ParseProcessorList(sharedProcessors);
+                    if (!shared.empty()) {
+                        highestLevel = level;
+                        owner = *std::min_element(shared.begin(), shared.end());
+                    }
+                }
+            }
+
+            return owner;
+        }
+
+    }
+
+    CpuTopology CpuTopology::Detect() {
+        std::string online;
+        if (!Internal::ReadValue(Internal::CPU_DIRECTORY + "online", online)) {
+            return Uniform(std::thread::hardware_concurrency());
+        }
+
+        // Processors excluded through the affinity mask of the process (taskset, cgroups) are not used.
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool hasAffinity = sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0;
+
+        std::vector<LogicalProcessor> processors;
+        for (unsigned id : Internal::ParseProcessorList(online)) {
+            if (hasAffinity && id < CPU_SETSIZE && !CPU_ISSET(id, &allowed)) {
+                continue;
+            }
+
+            std::string topologyDirectory = Internal::CPU_DIRECTORY + "cpu" + std::to_string(id) + "/topology/";
+            LogicalProcessor processor { };
+            processor.id = id;
+            processor.core = id;
+
+            Internal::ReadValue(topologyDirectory + "physical_package_id", processor.package);
+            Internal::ReadValue(topologyDirectory + "core_id", processor.core);
+
+            // First processor of the sibling list runs the primary hardware thread of the core.
+            std::string siblings;
+            if (Internal::ReadValue(topologyDirectory + "thread_siblings_list", siblings)) {
+                std::vector<unsigned> siblingProcessors = Internal::ParseProcessorList(siblings);
+                processor.smtSibling = !siblingProcessors.empty() && *std::min_element(siblingProcessors.begin(), siblingProcessors.end()) != id;
+            }
+
+            // Temporarily holds the owner of the cache, compacted below.
+            processor.cacheGroup = Internal::GetLastLevelCacheOwner(id);
+            processors.emplace_back(processor);
+        }
+
+        if (processors.empty()) {
+            return Uniform(std::thread::hardware_concurrency());
+        }
+
+        return CpuTopology(std::move(processors));
+    }
+
+    CpuTopology CpuTopology::Uniform(unsigned numProcessors) {
+        std::vector<LogicalProcessor> processors(std::max(numProcessors, 1u));
+
+        for (unsigned id = 0; id < processors.size(); ++id) {
+            processors[id].id = id;
+            processors[id].core = id;
+        }
+
+        return CpuTopology(std::move(processors));
+    }
+
+    CpuTopology::CpuTopology(std::vector<LogicalProcessor> processors) : processors_(std::move(processors)),
+                                                                         numCacheGroups_(0)
+                                                                         {
+        // Renumber cache groups to [0, numCacheGroups_).
+        std::unordered_map<unsigned, unsigned> cacheGroups;
+        for (LogicalProcessor& processor : processors_) {
+            auto iterator = cacheGroups.emplace(processor.cacheGroup, numCacheGroups_).first;
+            if (iterator->second == numCacheGroups_) {
+                ++numCacheGroups_;
+            }
+
+            processor.cacheGroup = iterator->second;
+        }
+    }
+
+    const std::vector<LogicalProcessor>& CpuTopology::GetProcessors() const {
+        return processors_;
+    }
+
+    unsigned CpuTopology::GetNumCacheGroups() const {
+        return numCacheGroups_;
+    }
+
+    std::vector<LogicalProcessor> CpuTopology::GetPlacementOrder(bool skipSmtSiblings) const {
+        std::vector<LogicalProcessor> order;
+
+        for (const LogicalProcessor& processor : processors_) {
+            if (!skipSmtSiblings || !processor.smtSibling) {
+                order.emplace_back(processor);
+            }
+        }
+
+        // Fill up one cache before moving on to the next, keeping work shared between workers close together.
+        std::stable_sort(order.begin(), order.end(), [](const LogicalProcessor& a, const LogicalProcessor& b) {
+            return std::tie(a.smtSibling, a.cacheGroup, a.package, a.core, a.id) < std::tie(b.smtSibling, b.cacheGroup, b.package, b.core, b.id);
+        });
+
+        return order;
+    }
+
+}
@@ -0,0 +1,80 @@
+
+#include "spark/job/worker/event_count.h"
+
+namespace Spark::Job {
+
+    EventCount::EventCount() : epoch_(0),
+                               numWaiters_(0)
+                               {
+    }
+
+    EventCount::~EventCount() {
+    }
+
+    std::uint64_t EventCount::PrepareWait() {
+        numWaiters_.fetch_add(1, std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_seq_cst);
+    }
+
+    void EventCount::CancelWait() {
+        numWaiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void EventCount::CommitWait(std::uint64_t key) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this, key]() {
+                return epoch_.load(std::memory_order_seq_cst) != key;
+            });
+        }
+
+        numWaiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    bool EventCount::CommitWait(std::uint64_t key, std::chrono::microseconds timeout) {
+        bool notified;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notified = condition_.wait_for(lock, timeout, [this, key]() {
+                return epoch_.load(std::memory_order_seq_cst) != key;
+            });
+        }
+
+        numWaiters_.fetch_sub(1, std::memory_order_seq_cst);
+        return notified;
+    }
+
+    bool EventCount::NotifyOne() {
+        // Pairs with the increment in PrepareWait: either the waiter sees the new work when it re-checks, or this
+        // sees the waiter.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (numWaiters_.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        condition_.notify_one();
+        return true;
+    }
+
+    void EventCount::NotifyAll() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        condition_.notify_all();
+    }
+
+    unsigned EventCount::GetNumWaiters() const {
+        return numWaiters_.load(std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,221 @@
+
+#include "spark/job/worker/fiber.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__SANITIZE_THREAD__)
+    #define SPARK_FIBER_SANITIZER
+#elif defined(__has_feature)
+    #if __has_feature(thread_sanitizer)
+        #define SPARK_FIBER_SANITIZER
+    #endif
+#endif
+
+#ifdef SPARK_FIBER_SANITIZER
+    #include <sanitizer/tsan_interface.h>
+#endif
+
+#if defined(__x86_64__)
+    // Saves the callee-saved registers (System V ABI) and floating point control words on the current stack, stores
+    // the stack pointer in *from and continues on the stack saved in to.
+    extern "C" void SparkSwitchFiber(void** from, void* to);
+
+    // First switch to a fiber lands here (see Fiber::Fiber): r12 holds the fiber, r13 the function to run.
+    extern "C" void SparkStartFiber();
+
+    asm(R"(
+        .text
+        .p2align 4
+        .globl SparkSwitchFiber
+        .hidden SparkSwitchFiber
+        .type SparkSwitchFiber, @function
+    SparkSwitchFiber:
+        pushq %rbp
+        pushq %rbx
+        pushq %r12
+        pushq %r13
+        pushq %r14
+        pushq %r15
+        subq $8, %rsp
+        stmxcsr (%rsp)
+        fnstcw 4(%rsp)
+        movq %rsp, (%rdi)
+        movq %rsi, %rsp
+        ldmxcsr (%rsp)
+        fldcw 4(%rsp)
+        addq $8, %rsp
+        popq %r15
+        popq %r14
+        popq %r13
+        popq %r12
+        popq %rbx
+        popq %rbp
+        ret
+        .size SparkSwitchFiber, .-SparkSwitchFiber
+
+        .p2align 4
+        .globl SparkStartFiber
+        .hidden SparkStartFiber
+        .type SparkStartFiber, @function
+    SparkStartFiber:
+        movq %r12, %rsi
+        movq %r12, %rdi
+        shrq $32, %rdi
+        callq *%r13
+        ud2
+        .size SparkStartFiber, .-SparkStartFiber
+    )");
+#endif
+
+namespace Spark::Job {
+
+    Fiber::Fiber(std::size_t stackSize) : context_(),
+                                          callerContext_(),
+                                          stack_(nullptr),
+                                          stackSize_(0),
+                                          jobHandle_(nullptr),
+                                          job_(nullptr),
+                                          isFinished_(true),
+                                          sanitizerFiber_(nullptr),
+                                          sanitizerCallerFiber_(nullptr)
+                                          {
+        // Lowest page is left inaccessible, overflowing the stack faults instead of corrupting the neighbouring one.
+        std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        stackSize_ = (stackSize + pageSize - 1) / pageSize * pageSize + pageSize;
+
+        stack_ = mmap(nullptr, stackSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        SP_ASSERT(stack_ != MAP_FAILED, "Failed to allocate fiber stack of %zu bytes.", stackSize_);
+        mprotect(stack_, pageSize, PROT_NONE);
+
+        // Run only takes int arguments (makecontext).
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(this);
+
+        #if defined(__x86_64__)
+            // Initial frame as SparkSwitchFiber leaves it: control words, r15 to rbp, return address. The stack pointer
+            // is 16 byte aligned after returning into SparkStartFiber, as required for its call.
+            std::uintptr_t top = (reinterpret_cast<std::uintptr_t>(stack_) + stackSize_) & ~static_cast<std::uintptr_t>(15);
+            auto* frame = reinterpret_cast<std::uint64_t*>(top - 16 - 8 * sizeof(std::uint64_t));
+
+            frame[0] = 0x037F00001F80ull;  // Default MXCSR and x87 control word.
+            frame[1] = 0;                  // r15
+            frame[2] = 0;                  // r14
+            frame[3] = reinterpret_cast<std::uint64_t>(&Fiber::Run);  // r13
+            frame[4] = address;            // r12
+            frame[5] = 0;                  // rbx
+            frame[6] = 0;                  // rbp
+            frame[7] = reinterpret_cast<std::uint64_t>(&SparkStartFiber);
+
+            context_ = frame;
+        #else
+            getcontext(&context_);
+            context_.uc_stack.ss_sp = stack_;
+            context_.uc_stack.ss_size = stackSize_;
+            context_.uc_link = nullptr;
+            makecontext(&context_, reinterpret_cast<void (*)()>(&Fiber::Run), 2, static_cast<unsigned>(address >> 32u), static_cast<unsigned>(address));
+        #endif
+
+        #ifdef SPARK_FIBER_SANITIZER
+            sanitizerFiber_ = __tsan_create_fiber(0);
+        #endif
+    }
+
+    Fiber::~Fiber() {
+        SP_ASSERT(isFinished_, "Fiber destroyed while a job is suspended on it.");
+
+        #ifdef SPARK_FIBER_SANITIZER
+            __tsan_destroy_fiber(sanitizerFiber_);
+        #endif
+
+        munmap(stack_, stackSize_);
+    }
+
+    void Fiber::Start(JobHandle* jobHandle, JobStorage* job) {
+        SP_ASSERT(isFinished_, "Starting a job on a fiber with a suspended job.");
+
+        jobHandle_ = jobHandle;
+        job_ = job;
+        isFinished_ = false;
+    }
+
+    bool Fiber::Resume() {
+        SwitchTo(true);
+        return isFinished_;
+    }
+
+    void Fiber::Suspend() {
+        SwitchTo(false);
+    }
+
+    JobHandle* Fiber::GetJobHandle() const {
+        return jobHandle_;
+    }
+
+    void Fiber::Run(unsigned high, unsigned low) {
+        Fiber* fiber = reinterpret_cast<Fiber*>((static_cast<std::uintptr_t>(high) << 32u) | low);
+
+        // Fibers never return, a finished fiber waits here for its next job.
+        while (true) {
+            fiber->job_->Execute();
+            fiber->isFinished_ = true;
+            fiber->Suspend();
+        }
+    }
+
+    void Fiber::SwitchTo(bool toFiber) {
+        #ifdef SPARK_FIBER_SANITIZER
+            if (toFiber) {
+                sanitizerCallerFiber_ = __tsan_get_current_fiber();
+            }
+
+            __tsan_switch_to_fiber(toFiber ? sanitizerFiber_ : sanitizerCallerFiber_, 0);
+        #endif
+
+        #if defined(__x86_64__)
+            if (toFiber) {
+                SparkSwitchFiber(&callerContext_, context_);
+            }
+            else {
+                SparkSwitchFiber(&context_, callerContext_);
+            }
+        #else
+            if (toFiber) {
+                swapcontext(&callerContext_, &context_);
+            }
+            else {
+                swapcontext(&context_, &callerContext_);
+            }
+        #endif
+    }
+
+    FiberPool::FiberPool(unsigned numFibers, std::size_t stackSize) {
+        fibers_.reserve(numFibers);
+        available_.reserve(numFibers);
+
+        for (unsigned i = 0; i < numFibers; ++i) {
+            fibers_.emplace_back(std::make_unique<Fiber>(stackSize));
+            available_.emplace_back(fibers_.back().get());
+        }
+    }
+
+    FiberPool::~FiberPool() {
+    }
+
+    unsigned FiberPool::Acquire(std::vector<Fiber*>& fibers, unsigned count) {
+        std::scoped_lock<std::mutex> lock(mutex_);
+
+        unsigned numFibers = std::min(count, static_cast<unsigned>(available_.size()));
+        fibers.insert(fibers.end(), available_.end() - numFibers, available_.end());
+        available_.resize(available_.size() - numFibers);
+        return numFibers;
+    }
+
+    void FiberPool::Release(Fiber* fiber) {
+        std::scoped_lock<std::mutex> lock(mutex_);
+        available_.emplace_back(fiber);
+    }
+
+    unsigned FiberPool::GetNumFibers() const {
+        return static_cast<unsigned>(fibers_.size());
+    }
+
+}
@@ -0,0 +1,109 @@
+
+#include "spark/job/worker/injection_queue.h"
+
+namespace Spark::Job {
+
+    InjectionQueue::InjectionQueue(std::size_t capacity) : slots_(std::make_unique<Slot[]>(capacity)),
+                                                           mask_(capacity - 1),
+                                                           enqueuePosition_(0),
+                                                           dequeuePosition_(0),
+                                                           numOverflowJobs_(0)
+                                                           {
+        SP_ASSERT(capacity > 1 && !(capacity & (capacity - 1)), "InjectionQueue capacity must be a power of 2.");
+
+        for (std::size_t i = 0; i < capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+            slots_[i].jobHandle = nullptr;
+        }
+    }
+
+    InjectionQueue::~InjectionQueue() {
+    }
+
+    bool InjectionQueue::TryPush(JobHandle* jobHandle) {
+        std::size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+
+        while (true) {
+            Slot& slot = slots_[position & mask_];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (difference == 0) {
+                // Slot is free for this lap, claim it.
+                if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.jobHandle = jobHandle;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                // Slot still holds a job from the previous lap.
+                return false;
+            }
+            else {
+                position = enqueuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void InjectionQueue::PushOverflow(JobHandle* jobHandle) {
+        std::scoped_lock<std::mutex> lock(overflowMutex_);
+        overflow_.emplace_back(jobHandle);
+        numOverflowJobs_.store(overflow_.size(), std::memory_order_release);
+    }
+
+    JobHandle* InjectionQueue::TryPop() {
+        std::size_t position = dequeuePosition_.load(std::memory_order_relaxed);
+
+        while (true) {
+            Slot& slot = slots_[position & mask_];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+
+            if (difference == 0) {
+                if (dequeuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    JobHandle* jobHandle = slot.jobHandle;
+
+                    // Free the slot for the next lap.
+                    slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+                    return jobHandle;
+                }
+            }
+            else if (difference < 0) {
+                // Empty.
+                break;
+            }
+            else {
+                position = dequeuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (numOverflowJobs_.load(std::memory_order_acquire) == 0) {
+            return nullptr;
+        }
+
+        std::scoped_lock<std::mutex> lock(overflowMutex_);
+        if (overflow_.empty()) {
+            return nullptr;
+        }
+
+        JobHandle* jobHandle = overflow_.front();
+        overflow_.pop_front();
+        numOverflowJobs_.store(overflow_.size(), std::memory_order_relaxed);
+
+        return jobHandle;
+    }
+
+    std::size_t InjectionQueue::GetSize() const {
+        std::size_t enqueuePosition = enqueuePosition_.load(std::memory_order_relaxed);
+        std::size_t dequeuePosition = dequeuePosition_.load(std::memory_order_relaxed);
+        std::size_t size = enqueuePosition > dequeuePosition ? enqueuePosition - dequeuePosition : 0;
+
+        return size + numOverflowJobs_.load(std::memory_order_acquire);
+    }
+
+    bool InjectionQueue::IsEmpty() const {
+        return GetSize() == 0;
+    }
+
+}
@@ -0,0 +1,115 @@
+
+#include "spark/job/worker/job_trace.h"
+#include <chrono>
+
+namespace Spark::Job {
+
+    namespace Internal {
+
+        double GetTimestampPeriod() {
+            #if defined(__x86_64__) || defined(__i386__)
+                // Measured against the steady clock from the first call, which happens when the first trace buffer is
+                // created. Assumes an invariant time stamp counter.
+                static const std::uint64_t startTimestamp = ReadTimestamp();
+                static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+                std::uint64_t timestamp = ReadTimestamp();
+                double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+
+                if (timestamp == startTimestamp || nanoseconds <= 0.0) {
+                    return 1.0;
+                }
+
+                return nanoseconds / static_cast<double>(timestamp - startTimestamp);
+            #else
+                return 1.0;
+            #endif
+        }
+
+    }
+
+    TraceBuffer::TraceBuffer(std::size_t capacity) : events_(std::make_unique<TraceEvent[]>(capacity)),
+                                                     mask_(capacity - 1),
+                                                     numEvents_(0),
+                                                     failedStealTimestamp_(0),
+                                                     numFailedSteals_(0),
+                                                     stealVictim_(0)
+                                                     {
+        SP_ASSERT((capacity & (capacity - 1)) == 0, "Trace buffer capacity must be a power of 2.");
+
+        // Starts timestamp calibration.
+        static_cast<void>(Internal::GetTimestampPeriod());
+    }
+
+    TraceBuffer::~TraceBuffer() {
+    }
+
+    std::vector<TraceEvent> TraceBuffer::GetEvents() const {
+        std::uint64_t numEvents = numEvents_.load(std::memory_order_acquire);
+        std::uint64_t first = numEvents > mask_ ? numEvents - mask_ - 1 : 0;
+
+        std::vector<TraceEvent> events;
+        events.reserve(static_cast<std::size_t>(numEvents - first));
+
+        for (std::uint64_t i = first; i < numEvents; ++i) {
+            events.emplace_back(events_[i & mask_]);
+        }
+
+        return events;
+    }
+
+    void WriteChromeTrace(std::ostream& stream, const std::vector<std::vector<TraceEvent>>& workerEvents) {
+        // Timestamps are relative to the earliest event, in microseconds.
+        std::uint64_t start = std::numeric_limits<std::uint64_t>::max();
+        for (const std::vector<TraceEvent>& events : workerEvents) {
+            if (!events.empty()) {
+                start = std::min(start, events.front().timestamp);
+            }
+        }
+
+        double period = Internal::GetTimestampPeriod() / 1000.0;
+        const char* separator = "\n";
+
+        stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+        for (std::size_t worker = 0; worker < workerEvents.size(); ++worker) {
+            std::string name = worker == 0 ? "Main thread" : "Worker " + std::to_string(worker);
+            stream << separator << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << worker << R"(,"args":{"name":")" << name << "\"}}";
+            separator = ",\n";
+
+            for (const TraceEvent& event : workerEvents[worker]) {
+                stream << separator << R"({"pid":0,"tid":)" << worker << R"(,"ts":)" << std::fixed << std::setprecision(3) << static_cast<double>(event.timestamp - start) * period << ",";
+
+                switch (event.type) {
+                    case TraceEventType::JOB_BEGIN:
+                        stream << R"("name":"Job","ph":"B","args":{"priority":)" << event.argument << "}}";
+                        break;
+                    case TraceEventType::JOB_END:
+                        stream << R"("ph":"E"})";
+                        break;
+                    case TraceEventType::JOB_SUSPEND:
+                        stream << R"("ph":"E","args":{"suspended":true}})";
+                        break;
+                    case TraceEventType::RELEASE:
+                        stream << R"("name":"Release","ph":"i","s":"t","args":{"jobs":)" << event.argument << "}}";
+                        break;
+                    case TraceEventType::STEAL:
+                        stream << R"("name":"Steal","ph":"i","s":"t","args":{"victim":)" << event.argument << "}}";
+                        break;
+                    case TraceEventType::STEAL_FAILED:
+                        stream << R"("name":"Steal failed","ph":"i","s":"t","args":{"attempts":)" << event.argument << "}}";
+                        break;
+                    case TraceEventType::PARK:
+                        stream << R"("name":"Parked","ph":"B"})";
+                        break;
+                    case TraceEventType::WAKE:
+                        stream << R"("ph":"E"})";
+                        break;
+                }
+            }
+        }
+
+        stream << "\n]}\n";
+    }
+
+}
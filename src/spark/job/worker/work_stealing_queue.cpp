@@ -3,50 +3,152 @@
 
 namespace Spark::Job {
 
-    WorkStealingQueue::WorkStealingQueue(std::size_t capacity) : capacity_(capacity),
-                                                                 top_(0),
+    WorkStealingQueue::RingBuffer::RingBuffer(std::int64_t capacity) : capacity_(capacity),
+                                                                       mask_(capacity - 1),
+                                                                       slots_(new std::atomic<JobHandle*>[capacity])
+                                                                       {
+    }
+
+    WorkStealingQueue::RingBuffer::~RingBuffer() {
+        delete[] slots_;
+    }
+
+    std::int64_t WorkStealingQueue::RingBuffer::GetCapacity() const {
+        return capacity_;
+    }
+
+    void WorkStealingQueue::RingBuffer::Store(std::int64_t index, JobHandle* handle) {
+        slots_[index & mask_].store(handle, std::memory_order_relaxed);
+    }
+
+    JobHandle* WorkStealingQueue::RingBuffer::Load(std::int64_t index) const {
+        return slots_[index & mask_].load(std::memory_order_relaxed);
+    }
+
+    WorkStealingQueue::RingBuffer* WorkStealingQueue::RingBuffer::Grow(std::int64_t bottom, std::int64_t top) const {
+        auto* buffer = new RingBuffer(capacity_ * 2);
+        for (std::int64_t i = top; i != bottom; ++i) {
+            buffer->Store(i, Load(i));
+        }
+
+        return buffer;
+    }
+
+    WorkStealingQueue::WorkStealingQueue(std::size_t capacity) : top_(0),
                                                                  bottom_(0),
-                                                                 collection_(new JobEntry[capacity_])
+                                                                 buffer_(nullptr)
                                                                  {
-        SP_ASSERT(capacity_ > 0, "RingBuffer capacity must be greater than 0.");
-        SP_ASSERT(!(capacity_ & (capacity_ - 1)), "RingBuffer capacity must be a power of 2.");
+        SP_ASSERT(capacity > 0, "WorkStealingQueue capacity must be greater than 0.");
+        SP_ASSERT(!(capacity & (capacity - 1)), "WorkStealingQueue capacity must be a power of 2.");
+        buffer_.store(new RingBuffer(static_cast<std::int64_t>(capacity)), std::memory_order_relaxed);
     }
 
     WorkStealingQueue::~WorkStealingQueue() {
-        delete[] collection_;
+        for (RingBuffer* buffer : retiredBuffers_) {
+            delete buffer;
+        }
+
+        delete buffer_.load(std::memory_order_relaxed);
     }
 
     // If bottom is greater than top, there are bottom - top elements in the queue.
     // If bottom is equal to or less than top, there are no elements in the queue.
 
-    std::optional<JobEntry> WorkStealingQueue::Pop() {
-        std::scoped_lock<std::mutex> lock(mutex_);
-        int numJobs = bottom_ - top_;
-        if (numJobs <= 0) {
+    void WorkStealingQueue::Push(JobHandle* handle) {
+        std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        std::int64_t top = top_.load(std::memory_order_acquire);
+        RingBuffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+        if (bottom - top > buffer->GetCapacity() - 1) {
+            // Queue is full, grow the buffer.
+            retiredBuffers_.emplace_back(buffer);
+            buffer = buffer->Grow(bottom, top);
+            buffer_.store(buffer, std::memory_order_release);
+        }
+
+        buffer->Store(bottom, handle);
+
+        // Publish the job before making it visible to thieves.
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    void WorkStealingQueue::Push(JobHandle* const* handles, std::size_t count) {
+        std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        std::int64_t top = top_.load(std::memory_order_acquire);
+        RingBuffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+        while (bottom - top + static_cast<std::int64_t>(count) > buffer->GetCapacity()) {
+            retiredBuffers_.emplace_back(buffer);
+            buffer = buffer->Grow(bottom, top);
+            buffer_.store(buffer, std::memory_order_release);
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer->Store(bottom + static_cast<std::int64_t>(i), handles[i]);
+        }
+
+        bottom_.store(bottom + static_cast<std::int64_t>(count), std::memory_order_release);
+    }
+
+    JobHandle* WorkStealingQueue::Pop() {
+        std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        RingBuffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+        // Reserve the bottom element before looking at top to synchronize with concurrent thieves.
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
             // Empty collection, nothing left to pop.
-            return std::nullopt;
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
         }
 
-        return { collection_[--bottom_ & mask_] };
+        JobHandle* handle = buffer->Load(bottom);
+
+        if (top == bottom) {
+            // Last element in the queue, race against thieves for it.
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                // Element was stolen.
+                handle = nullptr;
+            }
+
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return handle;
     }
 
-    std::optional<JobEntry> WorkStealingQueue::Steal() {
-        std::scoped_lock<std::mutex> lock(mutex_);
-        int numJobs = bottom_ - top_;
-        if (numJobs <= 0) {
+    JobHandle* WorkStealingQueue::Steal() {
+        std::int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
             // Empty collection, nothing left to steal.
-            return std::nullopt;
+            return nullptr;
         }
 
-        std::optional<JobEntry> jobEntry = { collection_[top_++ & mask_] }; // Increment top.
-        return jobEntry;
+        RingBuffer* buffer = buffer_.load(std::memory_order_acquire);
+        JobHandle* handle = buffer->Load(top);
+
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            // Lost the race to the owner or another thief.
+            return nullptr;
+        }
+
+        return handle;
+    }
+
+    std::size_t WorkStealingQueue::GetSize() const {
+        std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        std::int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
     }
 
-    bool WorkStealingQueue::Push(JobHandle* handle, const JobVariant& jobVariant) {
-        std::scoped_lock<std::mutex> lock(mutex_);
-        // Construct object.
-        collection_[bottom_++ & mask_] = std::make_pair<JobHandle*, JobVariant>(std::add_rvalue_reference<JobHandle*>::type(handle), std::add_rvalue_reference<JobVariant>::type(jobVariant) ); // Increment bottom.
-        return true;
+    bool WorkStealingQueue::IsEmpty() const {
+        return GetSize() == 0;
     }
 
 }
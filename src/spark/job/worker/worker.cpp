@@ -2,128 +2,605 @@
 #include "spark/job/worker/worker.h"
 #include "spark/job/job_system.h"
 #include "spark/logger/logger.h"
+#include <pthread.h>
 
 namespace Spark::Job {
 
-    Worker::Worker() : workerThreadActive_(true),
-                       workerThread_(std::thread(&Worker::Distribute, this)),
-                       deque_(WORKER_JOB_CAPACITY)
+    namespace Internal {
+
+        // Counters have a single writer.
+        inline void AddToCounter(std::atomic<std::uint64_t>& counter, std::uint64_t amount = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+    }
+
+    thread_local Fiber* Worker::currentFiber_ = nullptr;
+
+    Worker::Worker() : numSkips_(),
+                       numMailJobs_(0),
+                       numLocalVictims_(0),
+                       stealPolicy_(StealPolicy::SINGLE),
+                       randomState_(static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(this) >> 4u) | 1u),
+                       fiberPool_(nullptr),
+                       numIdleIterations_(0),
+                       numExecutedJobs_(0),
+                       numParks_(0),
+                       numWakeups_(0),
+                       index_(0),
+                       workerThreadActive_(false),
+                       isRunning_(false)
                        {
     }
 
     Worker::~Worker() {
-    	while (!waitlist_.empty()) {
-    		waitlist_.pop();
-    	}
+    }
+
+    void Worker::Start() {
+        SP_ASSERT(!isRunning_.load(), "Worker thread is already running.");
+
+        // Thread of a retired worker has already left its loop.
+        if (workerThread_.joinable()) {
+            workerThread_.join();
+        }
+
+        workerThreadActive_.store(true);
+        isRunning_.store(true);
+        workerThread_ = std::thread(&Worker::Distribute, this);
+    }
+
+    void Worker::AttachToCurrentThread() {
+        currentWorker_ = this;
     }
 
     void Worker::Distribute() {
+        currentWorker_ = this;
+
+        // Worker pool finishes setting up workers while the job system is being constructed.
+        WorkerPool& workerPool = Singleton<JobSystem>::GetInstance()->GetWorkerPool();
+
         while (workerThreadActive_.load()) {
-            std::optional<JobEntry> job = GetJob();
+            // Jobs only enter worker queues once all their dependencies are complete, any job found can be executed.
+            JobHandle* jobHandle = GetJob(workerPool.GetNumRunnablePriorities());
 
-            if (job.has_value()) {
-                JobEntry& entry = job.value();
-                JobHandle* jobHandle = entry.first;
+            if (jobHandle) {
+                ExecuteJob(jobHandle);
+                numIdleIterations_ = 0;
+                CountExecutedJob(workerPool);
+            }
+            else {
+                Idle();
+            }
+        }
 
-                // Don't execute job if job is not staged for execution.
-                int currentNumTries = 0;
-                const int maximumAllowedTries = 50;
+        currentWorker_ = nullptr;
+        isRunning_.store(false);
+    }
 
-                // Try to execute the job a number of times before putting it on the waitlist.
-                while (!jobHandle->IsReady() && currentNumTries <= maximumAllowedTries) {
-                	++currentNumTries;
-                	std::this_thread::yield();
-                }
+    void Worker::Idle() {
+        if (++numIdleIterations_ < WORKER_IDLE_SPIN_COUNT) {
+            std::this_thread::yield();
+            return;
+        }
 
-                // Job still is not ready, or there were too many attempts to execute.
-                if (!jobHandle->IsReady() || currentNumTries > maximumAllowedTries) {
-					PutJobOnWaitlist(entry);
-                    continue;
-                }
+        numIdleIterations_ = 0;
+        WorkerPool& workerPool = Singleton<JobSystem>::GetInstance()->GetWorkerPool();
+        EventCount& idleEvent = workerPool.GetIdleEvent();
+
+        // Idle workers are what lets an elastic pool shrink.
+        workerPool.Rebalance();
+
+        // Announce intent to park, then check for work one last time. Any job submitted after this point notifies
+        // the event count and wakes this worker back up.
+        std::uint64_t key = idleEvent.PrepareWait();
+        if (!workerThreadActive_.load() || workerPool.HasQueuedJobs(workerPool.GetNumRunnablePriorities())) {
+            idleEvent.CancelWait();
+            return;
+        }
+
+        numParks_.fetch_add(1, std::memory_order_relaxed);
+        SP_JOB_TRACE(TraceEventType::PARK, 0);
+        std::chrono::steady_clock::time_point parkTime = std::chrono::steady_clock::now();
+
+        // The worker next in line to be retired keeps sampling while parked, everyone else sleeps until notified.
+        if (workerPool.IsRetirementCandidate(this)) {
+            if (!idleEvent.CommitWait(key, std::chrono::milliseconds(WORKER_POOL_SAMPLE_INTERVAL))) {
+                // Park again right away if Rebalance did not retire this worker.
+                numIdleIterations_ = WORKER_IDLE_SPIN_COUNT - 1;
+            }
+        }
+        else {
+            idleEvent.CommitWait(key);
+        }
+
+        numWakeups_.fetch_add(1, std::memory_order_relaxed);
+        AddIdleTime(parkTime);
+        SP_JOB_TRACE(TraceEventType::WAKE, 0);
+    }
+
+    void Worker::Submit(JobHandle* jobHandle) {
+        if (currentWorker_ == this) {
+            WorkStealingQueue& deque = deques_[static_cast<unsigned>(jobHandle->GetPriority())];
+            deque.Push(jobHandle);
+            UpdatePeakQueueDepth(deque);
+        }
+        else {
+            std::scoped_lock<std::mutex> lock(mailboxMutex_);
+            mailbox_.emplace_back(jobHandle);
+            numMailJobs_.store(mailbox_.size(), std::memory_order_release);
+        }
+
+        // Wake up exactly one parked worker (if any) to pick up the job.
+        Singleton<JobSystem>::GetInstance()->GetWorkerPool().NotifyWorker();
+    }
+
+    void Worker::Submit(JobHandle* const* jobHandles, std::size_t count) {
+        if (count == 0) {
+            return;
+        }
+
+        if (currentWorker_ == this) {
+            WorkStealingQueue& deque = deques_[static_cast<unsigned>(jobHandles[0]->GetPriority())];
+            deque.Push(jobHandles, count);
+            UpdatePeakQueueDepth(deque);
+        }
+        else {
+            std::scoped_lock<std::mutex> lock(mailboxMutex_);
+            mailbox_.insert(mailbox_.end(), jobHandles, jobHandles + count);
+            numMailJobs_.store(mailbox_.size(), std::memory_order_release);
+        }
+
+        Singleton<JobSystem>::GetInstance()->GetWorkerPool().NotifyWorker();
+    }
+
+    bool Worker::HasQueuedJobs(unsigned numPriorities) const {
+        if (numMailJobs_.load(std::memory_order_acquire) != 0) {
+            return true;
+        }
+
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            if (!deques_[priority].IsEmpty()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::size_t Worker::GetNumQueuedJobs() const {
+        std::size_t numQueuedJobs = numMailJobs_.load(std::memory_order_acquire);
+
+        for (const WorkStealingQueue& deque : deques_) {
+            numQueuedJobs += deque.GetSize();
+        }
+
+        return numQueuedJobs;
+    }
+
+    IdleStatistics Worker::GetIdleStatistics() const {
+        IdleStatistics statistics { };
+        statistics.numParks = numParks_.load(std::memory_order_relaxed);
+        statistics.numWakeups = numWakeups_.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    WorkerStatistics Worker::GetStatistics() const {
+        WorkerStatistics statistics { };
+        statistics.numExecutedJobs = counters_.numExecutedJobs.load(std::memory_order_relaxed);
+        statistics.numSkippedJobs = counters_.numSkippedJobs.load(std::memory_order_relaxed);
+        statistics.numSteals = counters_.numSteals.load(std::memory_order_relaxed);
+        statistics.numFailedSteals = counters_.numFailedSteals.load(std::memory_order_relaxed);
+        statistics.numRequeuedJobs = counters_.numRequeuedJobs.load(std::memory_order_relaxed);
+        statistics.idleTime = counters_.idleTime.load(std::memory_order_relaxed);
+        statistics.peakQueueDepth = counters_.peakQueueDepth.load(std::memory_order_relaxed);
+        statistics.numQueuedJobs = GetNumQueuedJobs();
+        return statistics;
+    }
+
+    void Worker::SetVictims(std::vector<Worker*> victims, std::size_t numLocalVictims, StealPolicy stealPolicy) {
+        victims_ = std::move(victims);
+        numLocalVictims_ = numLocalVictims;
+        stealPolicy_ = stealPolicy;
+    }
+
+    bool Worker::SetAffinity(unsigned processor) {
+        cpu_set_t processors;
+        CPU_ZERO(&processors);
+        CPU_SET(processor, &processors);
+        return pthread_setaffinity_np(workerThread_.native_handle(), sizeof(cpu_set_t), &processors) == 0;
+    }
+
+    void Worker::SetFiberPool(FiberPool* fiberPool) {
+        fiberPool_ = fiberPool;
+    }
+
+    Worker* Worker::GetCurrentWorker() {
+        return currentWorker_;
+    }
+
+    #ifdef SPARK_JOB_TRACING
+        std::vector<TraceEvent> Worker::GetTraceEvents() const {
+            return traceBuffer_.GetEvents();
+        }
+    #endif
+
+    void Worker::SetIndex(unsigned index) {
+        index_ = index;
+    }
+
+    void Worker::CountExecutedJob(WorkerPool& workerPool) {
+        if (++numExecutedJobs_ % 64 == 0) {
+            workerPool.Rebalance();
+        }
+    }
+
+    void Worker::DrainMailbox() {
+        if (numMailJobs_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+
+        std::scoped_lock<std::mutex> lock(mailboxMutex_);
+        for (JobHandle* jobHandle : mailbox_) {
+            deques_[static_cast<unsigned>(jobHandle->GetPriority())].Push(jobHandle);
+        }
+
+        mailbox_.clear();
+        numMailJobs_.store(0, std::memory_order_relaxed);
+
+        for (const WorkStealingQueue& deque : deques_) {
+            UpdatePeakQueueDepth(deque);
+        }
+    }
+
+    void Worker::AddIdleTime(std::chrono::steady_clock::time_point parkTime) {
+        std::chrono::steady_clock::duration idleTime = std::chrono::steady_clock::now() - parkTime;
+        Internal::AddToCounter(counters_.idleTime, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(idleTime).count()));
+    }
+
+    void Worker::UpdatePeakQueueDepth(const WorkStealingQueue& deque) {
+        std::uint64_t depth = deque.GetSize();
+        if (depth > counters_.peakQueueDepth.load(std::memory_order_relaxed)) {
+            counters_.peakQueueDepth.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    JobHandle* Worker::GetJob(unsigned numPriorities) {
+        WorkerPool& workerPool = Singleton<JobSystem>::GetInstance()->GetWorkerPool();
+
+        // Move jobs submitted from other threads onto the deque so they can be stolen.
+        DrainMailbox();
+
+        // Jobs with a deadline go ahead of the jobs of their own priority and below, never ahead of higher priorities.
+        JobHandle* jobHandle = nullptr;
+        unsigned deadlinePriority = workerPool.GetDeadlinePriority(numPriorities);
+        if (deadlinePriority < numPriorities) {
+            jobHandle = deadlinePriority > 0 ? PopJob(deadlinePriority) : nullptr;
+            if (!jobHandle) {
+                jobHandle = workerPool.PopDeadlineJob(numPriorities);
+            }
+
+            if (jobHandle) {
+                return jobHandle;
+            }
+        }
+
+        jobHandle = PopJob(numPriorities);
+        if (jobHandle) {
+            return jobHandle;
+        }
+
+        // Jobs submitted from outside the worker pool come next, they have no other worker to go to.
+        jobHandle = workerPool.PopInjectedJob(numPriorities);
+        if (jobHandle) {
+            return jobHandle;
+        }
+
+        // Proceed with work stealing if this worker has no jobs. Workers sharing a cache with this worker are tried
+        // first. Failed steals return nullptr, yield and try again later.
+        jobHandle = StealFromVictims(0, numLocalVictims_, numPriorities);
+        if (jobHandle) {
+            return jobHandle;
+        }
+
+        jobHandle = StealFromVictims(numLocalVictims_, victims_.size(), numPriorities);
+        if (!jobHandle) {
+            Internal::AddToCounter(counters_.numFailedSteals);
+            SP_JOB_TRACE(TraceEventType::STEAL_FAILED, 1);
+        }
+
+        return jobHandle;
+    }
+
+    JobHandle* Worker::StealFromVictims(std::size_t begin, std::size_t end, unsigned numPriorities) {
+        std::size_t numVictims = end - begin;
+        if (numVictims == 0) {
+            return nullptr;
+        }
 
-                // Don't execute job if dependencies are not complete.
-                bool execute = true;
+        // Start at a random victim so thieves spread out, then go round-robin.
+        std::size_t offset = Internal::ReduceRandom(Internal::NextRandom(randomState_), static_cast<std::uint32_t>(numVictims));
 
-                for (const JobHandle* dependency : jobHandle->GetDependencies()) {
-                    if (!dependency->IsComplete()) {
-						PutJobOnWaitlist(entry);
-                        execute = false;
-                    }
+        for (std::size_t i = 0; i < numVictims; ++i) {
+            Worker* victim = victims_[begin + (offset + i) % numVictims];
+            JobHandle* jobHandle = stealPolicy_ == StealPolicy::HALF ? StealBatch(victim, numPriorities) : victim->Steal(numPriorities);
+
+            if (jobHandle) {
+                Internal::AddToCounter(counters_.numSteals);
+                SP_JOB_TRACE(TraceEventType::STEAL, victim->index_);
+                return jobHandle;
+            }
+        }
+
+        return nullptr;
+    }
+
+    JobHandle* Worker::StealBatch(Worker* victim, unsigned numPriorities) {
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            WorkStealingQueue& source = victim->deques_[priority];
+            JobHandle* jobHandle = source.Steal();
+            if (!jobHandle) {
+                continue;
+            }
+
+            // Move up to half of the remaining jobs over to this worker. Jobs are taken one at a time: the owner pops
+            // without synchronizing as long as top < bottom, so the top of the deque cannot be advanced by more than
+            // one job per CAS.
+            std::size_t numJobs = std::min<std::size_t>(source.GetSize() / 2, WORKER_STEAL_BATCH_SIZE - 1);
+            for (std::size_t i = 0; i < numJobs; ++i) {
+                JobHandle* stolen = source.Steal();
+                if (!stolen) {
+                    break;
                 }
 
-                if (execute) {
-                    ExecuteJob(job.value());
+                deques_[priority].Push(stolen);
+            }
+
+            UpdatePeakQueueDepth(deques_[priority]);
+
+            return jobHandle;
+        }
+
+        return victim->StealFromMailbox(numPriorities);
+    }
+
+    JobHandle* Worker::PopJob(unsigned numPriorities) {
+        // Aged lower priority jobs go first.
+        for (unsigned priority = numPriorities - 1; priority > 0; --priority) {
+            if (numSkips_[priority] < JOB_PRIORITY_AGING_LIMIT) {
+                continue;
+            }
+
+            numSkips_[priority] = 0;
+            JobHandle* jobHandle = deques_[priority].Pop();
+            if (jobHandle) {
+                return jobHandle;
+            }
+        }
+
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            JobHandle* jobHandle = deques_[priority].Pop();
+            if (!jobHandle) {
+                continue;
+            }
+
+            // Count this pick against every lower priority queue that still has jobs waiting.
+            numSkips_[priority] = 0;
+            for (unsigned lower = priority + 1; lower < NUM_JOB_PRIORITIES; ++lower) {
+                if (!deques_[lower].IsEmpty()) {
+                    ++numSkips_[lower];
                 }
             }
+
+            return jobHandle;
         }
+
+        return nullptr;
     }
 
-    std::optional<JobEntry> Worker::GetJob() {
-    	// Parse waiting jobs first.
-    	if (!waitlist_.empty()) {
-    		std::optional<JobEntry> job = { waitlist_.front() }; // Well-defined, guaranteed to exist.
-			SP_ASSERT(job.has_value(), "Job popped from worker waiting queue does not have value.");
+    JobHandle* Worker::Steal(unsigned numPriorities) {
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            JobHandle* jobHandle = deques_[priority].Steal();
+            if (jobHandle) {
+                return jobHandle;
+            }
+        }
 
-			waitlist_.pop();
-			return job;
-    	}
+        return StealFromMailbox(numPriorities);
+    }
+
+    JobHandle* Worker::StealFromMailbox(unsigned numPriorities) {
+        if (numMailJobs_.load(std::memory_order_acquire) == 0) {
+            return nullptr;
+        }
+
+        // Jobs in the mailbox of a parked worker would otherwise wait until that worker wakes up, as the notification
+        // for them may have gone to a different thread.
+        std::unique_lock<std::mutex> lock(mailboxMutex_, std::try_to_lock);
+        if (!lock.owns_lock() || mailbox_.empty()) {
+            return nullptr;
+        }
+
+        // Take the highest priority job.
+        auto highest = std::min_element(mailbox_.begin(), mailbox_.end(), [](const JobHandle* a, const JobHandle* b) {
+            return a->GetPriority() < b->GetPriority();
+        });
 
-    	// Proceed with work stealing if waiting queue has no job.
-        std::optional<JobEntry> job = deque_.Pop();
+        JobHandle* jobHandle = *highest;
+        if (static_cast<unsigned>(jobHandle->GetPriority()) >= numPriorities) {
+            return nullptr;
+        }
+
+        mailbox_.erase(highest);
+        numMailJobs_.store(mailbox_.size(), std::memory_order_relaxed);
+
+        return jobHandle;
+    }
 
-        // Pop from this worker queue was empty.
-        if (!job.has_value()) {
-            const WorkerPool& workerPool = Singleton<JobSystem>::GetInstance()->GetWorkerPool();
-            Worker* worker = workerPool.GetRandomWorker();
+    void Worker::ExecuteJob(JobHandle* jobHandle) {
+        JobStorage& job = jobHandle->GetJob();
 
-            if (worker == this) {
-                // Don't try to steal from this queue.
-                return std::nullopt;
+        if (job.IsEmpty()) {
+            LogWarning("Entered ExecuteJob with no provided job (JobHandle contains no job).");
+            FinishJob(jobHandle);
+            return;
+        }
+
+        // Cancelled before it started, completes without running.
+        if (jobHandle->Skip()) {
+            if (currentWorker_) {
+                Internal::AddToCounter(currentWorker_->counters_.numSkippedJobs);
             }
 
-            std::optional<JobEntry> stolenJob = worker->deque_.Steal();
-            if (!stolenJob.has_value()) {
-                // Failed to steal, yield and try again later.
-                return std::nullopt;
+            FinishJob(jobHandle);
+            return;
+        }
+
+        // Jobs suspended in WaitFor continue on their own fiber.
+        Fiber* fiber = jobHandle->GetFiber();
+        if (!fiber && currentWorker_) {
+            fiber = currentWorker_->AcquireFiber();
+
+            if (fiber) {
+                fiber->Start(jobHandle, &job);
+                jobHandle->SetFiber(fiber);
             }
+        }
+
+        Fiber* outerFiber = currentFiber_;
+        currentFiber_ = fiber;
+        SP_JOB_TRACE(TraceEventType::JOB_BEGIN, static_cast<std::uint32_t>(jobHandle->GetPriority()));
+
+        if (!fiber) {
+            job.Execute();
+            currentFiber_ = outerFiber;
+            SP_JOB_TRACE(TraceEventType::JOB_END, 0);
+
+            if (currentWorker_) {
+                Internal::AddToCounter(currentWorker_->counters_.numExecutedJobs);
+            }
+
+            RecordDeadline(jobHandle);
+            FinishJob(jobHandle);
+            return;
+        }
+
+        // Control comes back on this thread once the job completes or suspends.
+        bool isFinished = fiber->Resume();
+        currentFiber_ = outerFiber;
+
+        if (!isFinished) {
+            SP_JOB_TRACE(TraceEventType::JOB_SUSPEND, 0);
+
+            if (currentWorker_) {
+                Internal::AddToCounter(currentWorker_->counters_.numRequeuedJobs);
+            }
+
+            // Fiber has switched out, the job can be submitted again once its dependency completes.
+            jobHandle->ReleaseDependency();
+            return;
+        }
+
+        SP_JOB_TRACE(TraceEventType::JOB_END, 0);
+
+        // Counted once, however many times the job suspended.
+        if (currentWorker_) {
+            Internal::AddToCounter(currentWorker_->counters_.numExecutedJobs);
+        }
+
+        jobHandle->SetFiber(nullptr);
+        ReleaseFiber(fiber);
+        RecordDeadline(jobHandle);
+        FinishJob(jobHandle);
+    }
 
-            return stolenJob;
+    void Worker::RecordDeadline(const JobHandle* jobHandle) {
+        if (jobHandle->HasDeadline()) {
+            bool isMissed = std::chrono::steady_clock::now() > jobHandle->GetDeadline();
+            Singleton<JobSystem>::GetInstance()->GetWorkerPool().RecordDeadline(isMissed);
+        }
+    }
+
+    void Worker::WaitFor(JobHandle* jobHandle, std::uint32_t generation) {
+        Fiber* fiber = currentFiber_;
+        if (!fiber) {
+            jobHandle->Complete(generation);
+            return;
+        }
+
+        jobHandle->Stage(generation);
+        if (jobHandle->IsComplete(generation)) {
+            return;
         }
 
-        return job.value();
+        // Thread locals must not be accessed past this point, the fiber may be resumed on another thread.
+        fiber->GetJobHandle()->WaitOn(jobHandle, generation);
+        fiber->Suspend();
     }
 
-    void Worker::ExecuteJob(JobEntry& jobEntry) {
-        if (std::monostate* mono = std::get_if<std::monostate>(&jobEntry.second)) {
-            LogWarning("Entered ExecuteJob with no provided job (JobEntry contains std::monostate).");
+    Fiber* Worker::AcquireFiber() {
+        if (fiberCache_.empty() && (!fiberPool_ || !fiberPool_->Acquire(fiberCache_, WORKER_FIBER_CACHE_SIZE))) {
+            return nullptr;
+        }
+
+        Fiber* fiber = fiberCache_.back();
+        fiberCache_.pop_back();
+        return fiber;
+    }
+
+    void Worker::ReleaseFiber(Fiber* fiber) {
+        Worker* worker = currentWorker_;
+        if (!worker || !worker->fiberPool_) {
+            Singleton<JobSystem>::GetInstance()->GetWorkerPool().GetFiberPool()->Release(fiber);
             return;
         }
 
-        // Calls the virtual Execute function on the job the JobEntry contains.
-        std::visit(Internal::Visitor {
-            [] (std::monostate& ms) {
-                // Do nothing.
-            },
-            [] (auto& job) {
-                job.Execute();
+        // Fibers resumed on this worker were taken from other caches, hand the excess back.
+        worker->fiberCache_.emplace_back(fiber);
+        if (worker->fiberCache_.size() > 2 * WORKER_FIBER_CACHE_SIZE) {
+            for (unsigned i = 0; i < WORKER_FIBER_CACHE_SIZE; ++i) {
+                worker->fiberPool_->Release(worker->fiberCache_.back());
+                worker->fiberCache_.pop_back();
             }
-        }, jobEntry.second);
+        }
+    }
 
-        // Signal job completion.
-        JobHandle* jobHandle = jobEntry.first;
-        if (jobHandle) {
+    void Worker::FinishJob(JobHandle* jobHandle) {
+        JobSystem* jobSystem = Singleton<JobSystem>::GetInstance();
+        EventCount& idleEvent = jobSystem->GetWorkerPool().GetIdleEvent();
+
+        // Finishing the last child of a job finishes the job itself.
+        while (jobHandle && jobHandle->Finish()) {
+            JobHandle* parent = jobHandle->GetParent();
+
+            // Signal job completion, releasing dependent jobs onto this worker's queue.
             jobHandle->Signal();
+
+            // Recycle the handle, completing the job for any thread waiting on it.
+            jobSystem->ReturnJobHandle(jobHandle);
+
+            // Wake up threads parked in Complete.
+            if (jobHandle->HasWaiters()) {
+                idleEvent.NotifyAll();
+            }
+
+            jobHandle = parent;
         }
     }
 
+    void Worker::RequestTermination() {
+        workerThreadActive_.store(false);
+    }
+
     void Worker::Terminate() {
         workerThreadActive_.store(false);
-        SP_ASSERT(workerThread_.joinable(), "Thread is not joinable.");
-        workerThread_.join();
+
+        if (workerThread_.joinable()) {
+            workerThread_.join();
+        }
     }
 
-    void Worker::PutJobOnWaitlist(JobEntry& job) {
-    	waitlist_.emplace(std::move(job));
+    bool Worker::IsRunning() const {
+        return isRunning_.load();
     }
 
 }
@@ -1,20 +1,89 @@
 
 #include "spark/job/worker_pool.h"
+#include "spark/logger/logger.h"
+
+#include <cmath>
 
 namespace Spark::Job {
 
-    WorkerPool::WorkerPool(unsigned capacity) {
-        unsigned hardware = std::thread::hardware_concurrency();
-        if (hardware == 0) {
-            // Threading unsupported.
-            // Ignore capacity.
+    WorkerPool::WorkerPool(const WorkerPoolConfiguration& configuration, const CpuTopology& topology) : numNotifications_(0),
+                                                                                                       frameRiskTime_(std::numeric_limits<std::int64_t>::max()),
+                                                                                                       frameEndTime_(std::numeric_limits<std::int64_t>::max()),
+                                                                                                       isFrameAtRisk_(false),
+                                                                                                       frameStart_(),
+                                                                                                       frameBudget_(),
+                                                                                                       frameIndex_(0),
+                                                                                                       numFrameDeadlineJobs_(0),
+                                                                                                       numFrameMissedDeadlines_(0),
+                                                                                                       configuration_(configuration),
+                                                                                                       topology_(topology),
+                                                                                                       processors_(topology_.GetPlacementOrder(configuration_.pinning == ThreadPinning::PHYSICAL_CORES)),
+                                                                                                       workerCapacity_(1),
+                                                                                                       minActiveWorkers_(1),
+                                                                                                       numActiveWorkers_(1),
+                                                                                                       isElastic_(configuration.elastic),
+                                                                                                       averageQueueDepth_(0.0)
+                                                                                                       {
+        // Always keep at least one worker thread, even on single-core machines.
+        unsigned numProcessors = static_cast<unsigned>(processors_.size());
+        unsigned maxWorkers = configuration_.maxWorkers ? configuration_.maxWorkers : std::max(numProcessors, 2u) - 1;
+        unsigned minWorkers = std::clamp(configuration_.minWorkers, 1u, maxWorkers);
+        unsigned numWorkers = configuration_.numWorkers ? std::clamp(configuration_.numWorkers, minWorkers, maxWorkers) : maxWorkers;
+
+        workerCapacity_ = maxWorkers + 1;
+        minActiveWorkers_ = minWorkers + 1;
+        workers_ = new Worker[workerCapacity_];
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            workers_[i].SetIndex(i);
         }
-        else {
-            // Threading supported.
-            workerCapacity_ = std::clamp(capacity, 0u, hardware - 1);
+
+        if (configuration_.fibers) {
+            unsigned numFibers = configuration_.numFibers ? configuration_.numFibers : workerCapacity_ * JOB_FIBERS_PER_WORKER;
+            fiberPool_ = std::make_unique<FiberPool>(numFibers, configuration_.fiberStackSize);
+
+            for (unsigned i = 0; i < workerCapacity_; ++i) {
+                workers_[i].SetFiberPool(fiberPool_.get());
+            }
         }
 
-        workers_ = new Worker[workerCapacity_];
+        // Unpinned workers all share cache group 0.
+        std::vector<unsigned> cacheGroups(workerCapacity_, 0);
+        if (configuration_.pinning != ThreadPinning::NONE) {
+            for (unsigned i = 0; i < workerCapacity_; ++i) {
+                cacheGroups[i] = processors_[i % numProcessors].cacheGroup;
+            }
+        }
+
+        // Workers steal from workers sharing their cache first.
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            std::vector<Worker*> victims;
+            std::size_t numLocalVictims = 0;
+
+            for (unsigned j = 0; j < workerCapacity_; ++j) {
+                if (j != i && cacheGroups[j] == cacheGroups[i]) {
+                    victims.emplace_back(&workers_[j]);
+                    ++numLocalVictims;
+                }
+            }
+
+            for (unsigned j = 0; j < workerCapacity_; ++j) {
+                if (cacheGroups[j] != cacheGroups[i]) {
+                    victims.emplace_back(&workers_[j]);
+                }
+            }
+
+            workers_[i].SetVictims(std::move(victims), numLocalVictims, configuration_.stealPolicy);
+        }
+
+        // Worker threads wait for the job system to finish constructing before looking for jobs.
+        workers_[0].AttachToCurrentThread();
+        for (unsigned i = 1; i <= numWorkers; ++i) {
+            StartWorker(i);
+        }
+
+        numActiveWorkers_.store(numWorkers + 1, std::memory_order_release);
+        nextSample_ = lastSample_ = nextGrowth_ = lowDepthSince_ = std::chrono::steady_clock::now();
     }
 
     WorkerPool::~WorkerPool() {
@@ -26,16 +95,441 @@ namespace Spark::Job {
         return workerCapacity_;
     }
 
+    unsigned WorkerPool::GetNumActiveWorkers() const {
+        return numActiveWorkers_.load(std::memory_order_acquire);
+    }
+
     Worker* WorkerPool::GetRandomWorker() const {
-        static thread_local std::random_device device;
-        static thread_local std::mt19937 generator(device());
-        std::uniform_int_distribution<int> distribution(0, static_cast<int>(workerCapacity_) - 1);
+        static thread_local std::uint32_t state = static_cast<std::uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+
+        // There is always at least one worker thread besides the main thread.
+        unsigned numWorkerThreads = numActiveWorkers_.load(std::memory_order_acquire) - 1;
+        return &workers_[1 + Internal::ReduceRandom(Internal::NextRandom(state), numWorkerThreads)];
+    }
+
+    const WorkerPoolConfiguration& WorkerPool::GetConfiguration() const {
+        return configuration_;
+    }
+
+    const CpuTopology& WorkerPool::GetTopology() const {
+        return topology_;
+    }
+
+    IdleStatistics WorkerPool::GetIdleStatistics() const {
+        IdleStatistics statistics { };
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            IdleStatistics workerStatistics = workers_[i].GetIdleStatistics();
+            statistics.numParks += workerStatistics.numParks;
+            statistics.numWakeups += workerStatistics.numWakeups;
+        }
+
+        statistics.numNotifications = numNotifications_.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    std::vector<WorkerStatistics> WorkerPool::GetWorkerStatistics() const {
+        std::vector<WorkerStatistics> statistics;
+        statistics.reserve(workerCapacity_);
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            statistics.emplace_back(workers_[i].GetStatistics());
+        }
+
+        return statistics;
+    }
+
+    WorkerStatistics WorkerPool::GetStatistics() const {
+        WorkerStatistics statistics { };
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            WorkerStatistics workerStatistics = workers_[i].GetStatistics();
+            statistics.numExecutedJobs += workerStatistics.numExecutedJobs;
+            statistics.numSkippedJobs += workerStatistics.numSkippedJobs;
+            statistics.numSteals += workerStatistics.numSteals;
+            statistics.numFailedSteals += workerStatistics.numFailedSteals;
+            statistics.numRequeuedJobs += workerStatistics.numRequeuedJobs;
+            statistics.idleTime += workerStatistics.idleTime;
+            statistics.peakQueueDepth = std::max(statistics.peakQueueDepth, workerStatistics.peakQueueDepth);
+            statistics.numQueuedJobs += workerStatistics.numQueuedJobs;
+        }
+
+        // Jobs submitted from outside the worker pool.
+        for (const InjectionQueue& injectionQueue : injectionQueues_) {
+            statistics.numQueuedJobs += injectionQueue.GetSize();
+        }
+
+        return statistics;
+    }
+
+    #ifdef SPARK_JOB_TRACING
+        std::vector<std::vector<TraceEvent>> WorkerPool::GetTraceEvents() const {
+            std::vector<std::vector<TraceEvent>> events;
+            events.reserve(workerCapacity_);
+
+            for (unsigned i = 0; i < workerCapacity_; ++i) {
+                events.emplace_back(workers_[i].GetTraceEvents());
+            }
+
+            return events;
+        }
+    #endif
+
+    EventCount& WorkerPool::GetIdleEvent() {
+        return idleEvent_;
+    }
+
+    bool WorkerPool::HasQueuedJobs(unsigned numPriorities) const {
+        if (GetDeadlinePriority(numPriorities) < numPriorities) {
+            return true;
+        }
 
-        int index = distribution(generator);
-        return &workers_[index];
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            if (!injectionQueues_[priority].IsEmpty()) {
+                return true;
+            }
+        }
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            if (workers_[i].HasQueuedJobs(numPriorities)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void WorkerPool::Submit(JobHandle* jobHandle) {
+        if (jobHandle->HasDeadline()) {
+            {
+                DeadlineQueue& deadlineQueue = deadlineQueues_[static_cast<unsigned>(jobHandle->GetPriority())];
+                std::scoped_lock<std::mutex> lock(deadlineQueue.mutex);
+                deadlineQueue.jobs.emplace_back(jobHandle->GetDeadline(), jobHandle);
+                std::push_heap(deadlineQueue.jobs.begin(), deadlineQueue.jobs.end(), std::greater<>());
+                deadlineQueue.numJobs.store(deadlineQueue.jobs.size(), std::memory_order_release);
+            }
+
+            NotifyWorker();
+            return;
+        }
+
+        // Jobs released from a worker thread stay on that worker.
+        Worker* worker = Worker::GetCurrentWorker();
+        if (worker) {
+            worker->Submit(jobHandle);
+            return;
+        }
+
+        Inject(jobHandle);
+    }
+
+    void WorkerPool::Inject(JobHandle* jobHandle) {
+        InjectionQueue& injectionQueue = injectionQueues_[static_cast<unsigned>(jobHandle->GetPriority())];
+
+        if (!injectionQueue.TryPush(jobHandle)) {
+            switch (configuration_.overflowPolicy) {
+                case OverflowPolicy::GROW:
+                    injectionQueue.PushOverflow(jobHandle);
+                    break;
+
+                case OverflowPolicy::BLOCK:
+                    // Keep waking workers until one makes room.
+                    while (!injectionQueue.TryPush(jobHandle)) {
+                        NotifyWorker();
+                        std::this_thread::yield();
+                    }
+                    break;
+
+                case OverflowPolicy::INLINE:
+                    Worker::ExecuteJob(jobHandle);
+                    return;
+            }
+        }
+
+        // Wake up exactly one parked worker (if any) to pick up the job.
+        NotifyWorker();
+    }
+
+    JobHandle* WorkerPool::PopInjectedJob(unsigned numPriorities) {
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            InjectionQueue& injectionQueue = injectionQueues_[priority];
+            if (injectionQueue.IsEmpty()) {
+                continue;
+            }
+
+            JobHandle* jobHandle = injectionQueue.TryPop();
+            if (jobHandle) {
+                return jobHandle;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void WorkerPool::SubmitBatch(JobHandle* const* jobHandles, std::size_t count) {
+        // The main thread only runs jobs while waiting in Complete. It only gets a run when it submits the batch
+        // itself, which means it is completing the batch (or a job depending on it).
+        std::size_t first = Worker::GetCurrentWorker() == &workers_[0] ? 0 : 1;
+        std::size_t numWorkers = numActiveWorkers_.load(std::memory_order_acquire) - first;
+
+        for (std::size_t i = 0; i < numWorkers; ++i) {
+            std::size_t begin = count * i / numWorkers;
+            std::size_t end = count * (i + 1) / numWorkers;
+            workers_[first + i].Submit(jobHandles + begin, end - begin);
+        }
+    }
+
+    JobHandle* WorkerPool::PopDeadlineJob(unsigned numPriorities) {
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            DeadlineQueue& deadlineQueue = deadlineQueues_[priority];
+            if (deadlineQueue.numJobs.load(std::memory_order_acquire) == 0) {
+                continue;
+            }
+
+            std::scoped_lock<std::mutex> lock(deadlineQueue.mutex);
+            if (deadlineQueue.jobs.empty()) {
+                continue;
+            }
+
+            std::pop_heap(deadlineQueue.jobs.begin(), deadlineQueue.jobs.end(), std::greater<>());
+            JobHandle* jobHandle = deadlineQueue.jobs.back().second;
+            deadlineQueue.jobs.pop_back();
+            deadlineQueue.numJobs.store(deadlineQueue.jobs.size(), std::memory_order_release);
+            return jobHandle;
+        }
+
+        return nullptr;
+    }
+
+    unsigned WorkerPool::GetDeadlinePriority(unsigned numPriorities) const {
+        for (unsigned priority = 0; priority < numPriorities; ++priority) {
+            if (deadlineQueues_[priority].numJobs.load(std::memory_order_acquire) > 0) {
+                return priority;
+            }
+        }
+
+        return numPriorities;
+    }
+
+    unsigned WorkerPool::GetNumRunnablePriorities() const {
+        // No clock read while no frame is running.
+        std::int64_t riskTime = frameRiskTime_.load(std::memory_order_relaxed);
+        if (riskTime == std::numeric_limits<std::int64_t>::max()) {
+            return NUM_JOB_PRIORITIES;
+        }
+
+        if (!isFrameAtRisk_.load(std::memory_order_relaxed)) {
+            if (std::chrono::steady_clock::now().time_since_epoch().count() < riskTime) {
+                return NUM_JOB_PRIORITIES;
+            }
+
+            isFrameAtRisk_.store(true, std::memory_order_relaxed);
+        }
+
+        return NUM_JOB_PRIORITIES - 1;
+    }
+
+    void WorkerPool::RecordDeadline(bool isMissed) {
+        numFrameDeadlineJobs_.fetch_add(1, std::memory_order_relaxed);
+
+        if (isMissed) {
+            numFrameMissedDeadlines_.fetch_add(1, std::memory_order_relaxed);
+
+            // Background jobs are deferred for the rest of the frame.
+            if (frameRiskTime_.load(std::memory_order_relaxed) != std::numeric_limits<std::int64_t>::max()) {
+                isFrameAtRisk_.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void WorkerPool::BeginFrame(std::chrono::steady_clock::duration budget) {
+        frameStart_ = std::chrono::steady_clock::now();
+        frameBudget_ = budget;
+        ++frameIndex_;
+
+        numFrameDeadlineJobs_.store(0, std::memory_order_relaxed);
+        numFrameMissedDeadlines_.store(0, std::memory_order_relaxed);
+        isFrameAtRisk_.store(false, std::memory_order_relaxed);
+
+        std::chrono::steady_clock::time_point riskTime = frameStart_ + budget * JOB_FRAME_RISK_THRESHOLD / 100;
+        frameRiskTime_.store(riskTime.time_since_epoch().count(), std::memory_order_relaxed);
+        frameEndTime_.store((frameStart_ + budget).time_since_epoch().count(), std::memory_order_relaxed);
+
+        // Background jobs deferred by the previous frame can run again.
+        idleEvent_.NotifyAll();
+    }
+
+    FrameReport WorkerPool::EndFrame() {
+        FrameReport report { };
+        report.frameIndex = frameIndex_;
+        report.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart_);
+        report.budget = std::chrono::duration_cast<std::chrono::nanoseconds>(frameBudget_);
+        report.numDeadlineJobs = numFrameDeadlineJobs_.load(std::memory_order_relaxed);
+        report.numMissedDeadlines = numFrameMissedDeadlines_.load(std::memory_order_relaxed);
+        report.wasAtRisk = isFrameAtRisk_.load(std::memory_order_relaxed) || report.duration >= report.budget * JOB_FRAME_RISK_THRESHOLD / 100;
+
+        if (report.wasAtRisk) {
+            unsigned background = static_cast<unsigned>(JobPriority::BACKGROUND);
+            report.numDeferredJobs = injectionQueues_[background].GetSize();
+
+            for (unsigned i = 0; i < workerCapacity_; ++i) {
+                report.numDeferredJobs += workers_[i].deques_[background].GetSize();
+            }
+        }
+
+        frameRiskTime_.store(std::numeric_limits<std::int64_t>::max(), std::memory_order_relaxed);
+        frameEndTime_.store(std::numeric_limits<std::int64_t>::max(), std::memory_order_relaxed);
+        isFrameAtRisk_.store(false, std::memory_order_relaxed);
+        idleEvent_.NotifyAll();
+        return report;
+    }
+
+    std::chrono::steady_clock::time_point WorkerPool::GetFrameEnd() const {
+        std::int64_t endTime = frameEndTime_.load(std::memory_order_relaxed);
+        if (endTime == std::numeric_limits<std::int64_t>::max()) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(endTime));
+    }
+
+    JobHandle* WorkerPool::Steal() {
+        unsigned deadlinePriority = GetDeadlinePriority();
+        if (deadlinePriority < NUM_JOB_PRIORITIES) {
+            JobHandle* higher = deadlinePriority > 0 ? PopInjectedJob(deadlinePriority) : nullptr;
+            if (higher) {
+                return higher;
+            }
+
+            JobHandle* deadlineJob = PopDeadlineJob();
+            if (deadlineJob) {
+                return deadlineJob;
+            }
+        }
+
+        JobHandle* injected = PopInjectedJob();
+        if (injected) {
+            return injected;
+        }
+
+        Worker* first = GetRandomWorker();
+        unsigned offset = static_cast<unsigned>(first - workers_);
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            JobHandle* jobHandle = workers_[(offset + i) % workerCapacity_].Steal();
+            if (jobHandle) {
+                return jobHandle;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void WorkerPool::Rebalance() {
+        if (!isElastic_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(rebalanceMutex_, std::try_to_lock);
+        if (!lock.owns_lock() || !isElastic_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now < nextSample_) {
+            return;
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(now - lastSample_).count();
+        nextSample_ = now + std::chrono::milliseconds(WORKER_POOL_SAMPLE_INTERVAL);
+        lastSample_ = now;
+
+        std::size_t numQueuedJobs = 0;
+        for (const InjectionQueue& injectionQueue : injectionQueues_) {
+            numQueuedJobs += injectionQueue.GetSize();
+        }
+
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            numQueuedJobs += workers_[i].GetNumQueuedJobs();
+        }
+
+        // Samples are taken irregularly (every few jobs, or when workers go idle), each one weighs as much as the
+        // time since the previous one. Short bursts and the gaps between them both only move the average partially.
+        double weight = 1.0 - std::exp2(-elapsed / WORKER_POOL_DEPTH_HALF_LIFE);
+        averageQueueDepth_ += (static_cast<double>(numQueuedJobs) - averageQueueDepth_) * weight;
+
+        unsigned numActiveWorkers = numActiveWorkers_.load(std::memory_order_relaxed);
+        if (averageQueueDepth_ > static_cast<double>(numActiveWorkers * WORKER_POOL_GROW_DEPTH)) {
+            lowDepthSince_ = now;
+
+            // A retired worker thread may still be finishing its last job.
+            if (now >= nextGrowth_ && numActiveWorkers < workerCapacity_ && !workers_[numActiveWorkers].IsRunning()) {
+                StartWorker(numActiveWorkers);
+                numActiveWorkers_.store(numActiveWorkers + 1, std::memory_order_release);
+
+                // Give the new worker time to show in the average before starting another one.
+                nextGrowth_ = now + std::chrono::milliseconds(WORKER_POOL_DEPTH_HALF_LIFE);
+            }
+        }
+        else if (averageQueueDepth_ >= 1.0) {
+            lowDepthSince_ = now;
+        }
+        else if (now - lowDepthSince_ >= std::chrono::milliseconds(WORKER_POOL_RETIRE_DELAY) && numActiveWorkers > minActiveWorkers_) {
+            // Jobs left in the queues of the retired worker get stolen by the others.
+            numActiveWorkers_.store(numActiveWorkers - 1, std::memory_order_release);
+            workers_[numActiveWorkers - 1].RequestTermination();
+            lowDepthSince_ = now;
+
+            // Worker may be parked.
+            idleEvent_.NotifyAll();
+        }
+    }
+
+    FiberPool* WorkerPool::GetFiberPool() const {
+        return fiberPool_.get();
+    }
+
+    bool WorkerPool::IsRetirementCandidate(const Worker* worker) const {
+        if (!isElastic_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        unsigned numActiveWorkers = numActiveWorkers_.load(std::memory_order_acquire);
+        return numActiveWorkers > minActiveWorkers_ && worker == &workers_[numActiveWorkers - 1];
+    }
+
+    void WorkerPool::StartWorker(unsigned index) {
+        workers_[index].Start();
+
+        if (configuration_.pinning != ThreadPinning::NONE) {
+            const LogicalProcessor& processor = processors_[index % processors_.size()];
+
+            if (!workers_[index].SetAffinity(processor.id)) {
+                LogWarning("Failed to pin worker %u to processor %u.", index, processor.id);
+            }
+        }
+    }
+
+    void WorkerPool::NotifyWorker() {
+        if (idleEvent_.NotifyOne()) {
+            numNotifications_.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
     void WorkerPool::Shutdown() {
+        // No more workers get started or retired.
+        {
+            std::scoped_lock<std::mutex> lock(rebalanceMutex_);
+            isElastic_.store(false, std::memory_order_relaxed);
+        }
+
+        // Stop all workers first, then wake up any parked workers so they can observe the request.
+        for (unsigned i = 0; i < workerCapacity_; ++i) {
+            workers_[i].RequestTermination();
+        }
+
+        idleEvent_.NotifyAll();
+
         for (unsigned i = 0; i < workerCapacity_; ++i) {
             workers_[i].Terminate();
         }